@@ -119,6 +119,28 @@ int main (int argc, char **argv)
                     printf ("Required: tool running parameter,tool name.\n");
                 }
             }
+            else if (strcmp(argv[1], "--set-tool-requirement") == 0)
+            {
+                if (argc > 3)
+                {
+                    set_tool_requirement(doc, argv[2], argv[3]);
+                }
+                else
+                {
+                    printf ("Required: capability (threads), tool name.\n");
+                }
+            }
+            else if (strcmp(argv[1], "--set-tool-fallback") == 0)
+            {
+                if (argc > 3)
+                {
+                    set_tool_fallback(doc, argv[2], argv[3]);
+                }
+                else
+                {
+                    printf ("Required: first tier tool name, tool name.\n");
+                }
+            }
             else if (strcmp(argv[1], "--add-static-parameter") == 0)
             {
                 if (argc > 2)
@@ -215,6 +237,8 @@ help(void)
     printf ("--create-error [error description]\n");
     printf ("--register-error [error ID] [tool name]\n");
     printf ("--register-parameter [tool running parameter] [tool name]\n");
+    printf ("--set-tool-requirement [capability] [tool name]\n");
+    printf ("--set-tool-fallback [first tier tool name] [tool name]\n");
     printf ("--add-static-parameter [source name]\n");
     printf ("--set-executable [executable]\n");
     printf ("--add-dynamic-parameter [executable parameter]\n");
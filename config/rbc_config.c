@@ -250,6 +250,97 @@ register_parameter(rbc_xml_doc doc, const char *tool_parameter, const char * too
     return status_code;
 }
 
+int
+set_tool_requirement(rbc_xml_doc doc, const char *capability, const char *tool_name)
+{
+    int status_code = -1;
+    char buff[1024] = {0};
+    rbc_xml_node tool_node = NULL;
+
+    if (doc != NULL && doc->children != NULL &&
+        tool_name != NULL && capability != NULL)
+    {
+        const char *requires = "";
+        rbc_xml_filter_t vec[] =
+        {
+            /* .filter = TAG_NAME, .filter_value.tag = "installed_tools" */
+			{TAG_NAME, "installed_tools"},
+            /* .filter = TAG_NAME, .filter_value.tag = tool_name */
+			{TAG_NAME, ""}
+        };
+		vec[1].filter_value.tag = tool_name;
+
+        tool_node = lookup_node(doc->children, vec, 2);
+        if (tool_node == NULL)
+        {
+            fprintf(stderr, "Given tool is not installed: %s.\n", tool_name);
+            goto exit;
+        }
+
+        requires = get_node_property(tool_node, "requires");
+        if (requires != NULL && strstr(requires, capability) != NULL)
+        {
+            printf ("Capability %s allready required by tool=%s\n", capability, tool_name);
+            goto exit;
+        }
+
+        if (requires != NULL && strlen(requires) > 0)
+        {
+            sprintf(buff, "%s,%s", requires, capability);
+        }
+        else
+        {
+            sprintf(buff, "%s", capability);
+        }
+
+        xmlSetProp(tool_node, (xmlChar *) "requires", (xmlChar *) buff);
+        status_code = 0;
+    }
+
+exit:
+    return status_code;
+}
+
+int
+set_tool_fallback(rbc_xml_doc doc, const char *primary_name, const char *tool_name)
+{
+    int status_code = -1;
+    rbc_xml_node tool_node = NULL;
+
+    if (doc != NULL && doc->children != NULL &&
+        tool_name != NULL && primary_name != NULL)
+    {
+        rbc_xml_filter_t vec[] =
+        {
+            /* .filter = TAG_NAME, .filter_value.tag = "installed_tools" */
+			{TAG_NAME, "installed_tools"},
+            /* .filter = TAG_NAME, .filter_value.tag = tool_name */
+			{TAG_NAME, ""}
+        };
+
+		vec[1].filter_value.tag = primary_name;
+        if (lookup_node(doc->children, vec, 2) == NULL)
+        {
+            fprintf(stderr, "Given tool is not installed: %s.\n", primary_name);
+            goto exit;
+        }
+
+		vec[1].filter_value.tag = tool_name;
+        tool_node = lookup_node(doc->children, vec, 2);
+        if (tool_node == NULL)
+        {
+            fprintf(stderr, "Given tool is not installed: %s.\n", tool_name);
+            goto exit;
+        }
+
+        xmlSetProp(tool_node, (xmlChar *) "fallback_of", (xmlChar *) primary_name);
+        status_code = 0;
+    }
+
+exit:
+    return status_code;
+}
+
 int
 inc_err_count (rbc_xml_doc doc)
 {
@@ -42,6 +42,12 @@ register_error(rbc_xml_doc, const char *, const char * );
 int
 register_parameter(rbc_xml_doc, const char *, const char * );
 
+int
+set_tool_requirement(rbc_xml_doc, const char *, const char * );
+
+int
+set_tool_fallback(rbc_xml_doc, const char *, const char * );
+
 int
 inc_err_count (rbc_xml_doc );
 
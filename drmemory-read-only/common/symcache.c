@@ -34,6 +34,10 @@
 #include "symcache.h"
 #include "drmgr.h"
 #include "utils.h"
+#include "crypto.h"
+#ifdef LINUX
+# include "sysnum_linux.h"
+#endif
 
 #undef sscanf /* eliminate warning from utils.h b/c we have _GNU_SOURCE above */
 
@@ -61,7 +65,7 @@
  * because we include negative entries in the file and make no assumptions
  * that it is a complete record of all lookups we'll need.
  */
-#define SYMCACHE_VERSION 4
+#define SYMCACHE_VERSION 5
 
 /* we need a separate hashtable per module */
 #define SYMCACHE_MASTER_TABLE_HASH_BITS 6
@@ -79,6 +83,15 @@
 
 #define SYMCACHE_MAX_TMP_TRIES 1000
 
+#ifdef LINUX
+/* The number of bytes at the start of a module file covered by its checksum:
+ * the ELF header, the program headers and, usually, the build id note, so
+ * that a rebuilt module of the same size does not match a stale cache.
+ * This is stack allocated as well.
+ */
+# define SYMCACHE_CHECKSUM_SIZE 2048
+#endif
+
 /* We key on full path to reduce chance of duplicate name (i#729).
  * If we do have duplicate preferred name, though, note that only one can
  * have a symcache file b/c our file namespace does not have versions
@@ -108,7 +121,7 @@ typedef struct _mod_cache_t {
     uint timestamp;
     size_t module_internal_size;
 #else
-    /* XXX: may want more consistency checks */
+    uint checksum; /* crc32 of the first SYMCACHE_CHECKSUM_SIZE bytes */
 #endif
 } mod_cache_t;
 
@@ -241,8 +254,8 @@ symcache_write_symfile(const char *modname, mod_cache_t *modcache)
                    modcache->checksum, modcache->timestamp,
                    modcache->module_internal_size);
 #else
-    BUFFERED_WRITE(f, buf, bsz, sofar, len, UINT64_FORMAT_STRING"\n",
-                   modcache->module_file_size);
+    BUFFERED_WRITE(f, buf, bsz, sofar, len, UINT64_FORMAT_STRING",%u\n",
+                   modcache->module_file_size, modcache->checksum);
 #endif
     for (i = 0; i < HASHTABLE_SIZE(symtable->table_bits); i++) {
         hash_entry_t *he;
@@ -369,13 +382,18 @@ symcache_read_symfile(const module_data_t *mod, const char *modname, mod_cache_t
             goto symcache_read_symfile_done;
         }
 #else
-        if (sscanf(line, "%u,"UINT64_FORMAT_STRING,
-                   &cache_file_size, &module_file_size) != 2) {
+        uint checksum;
+        if (sscanf(line, "%u,"UINT64_FORMAT_STRING",%u",
+                   &cache_file_size, &module_file_size, &checksum) != 3) {
             WARN("WARNING: %s symbol cache file has bad consistency header\n", modname);
             goto symcache_read_symfile_done;
         }
-        if (module_file_size != modcache->module_file_size) {
+        if (module_file_size != modcache->module_file_size ||
+            checksum != modcache->checksum) {
             LOG(1, "module version mismatch: %s symbol cache file is stale\n", modname);
+            LOG(2, "\t"UINT64_FORMAT_STRING" vs "UINT64_FORMAT_STRING", %u vs %u\n",
+                module_file_size, modcache->module_file_size,
+                checksum, modcache->checksum);
             goto symcache_read_symfile_done;
         }
 #endif
@@ -417,6 +435,12 @@ symcache_read_symfile(const module_data_t *mod, const char *modname, mod_cache_t
         }
     }
     res = true;
+#ifdef LINUX
+    /* A file in use is newer than the ones written for modules no longer
+     * loaded: robocheck prunes a shared cache dir by mtime, oldest first.
+     */
+    raw_syscall_2args(SYS_utimes, (ptr_int_t) symfile, 0);
+#endif
  symcache_read_symfile_done:
     if (map != NULL)
         dr_unmap_file(map, actual_size);
@@ -524,6 +548,16 @@ symcache_module_load(void *drcontext, const module_data_t *mod, bool loaded)
         bool ok = dr_file_size(f, &modcache->module_file_size);
         if (!ok)
             WARN("WARNING: unable to determine size of %s\n", mod->full_path);
+#ifdef LINUX
+        {
+            char head[SYMCACHE_CHECKSUM_SIZE];
+            ssize_t head_size = dr_read_file(f, head, sizeof(head));
+            if (head_size > 0)
+                modcache->checksum = crc32(head, (uint) head_size);
+            else
+                WARN("WARNING: unable to read %s\n", mod->full_path);
+        }
+#endif
         dr_close_file(f);
     } else
         WARN("WARNING: unable to open %s\n", mod->full_path);
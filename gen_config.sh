@@ -62,26 +62,49 @@ robo_config --create-tool $NAME libdrmemory.so dynamic
 # Use tool -- used at startup
 robo_config --register-tool $NAME
 # Register parameters used when tool is running
+# symbol cache shared by the runs on this grader, capped at 64 MB
+robo_config --register-parameter "-symcache_dir /var/tmp/robocheck_symcache" $NAME
+robo_config --register-parameter "-symcache_cap 65536" $NAME
 # Register errors
 robo_config --register-error 1 $NAME
 robo_config --register-error 2 $NAME
 robo_config --register-error 3 $NAME
 robo_config --register-error 19 $NAME
 
+NAME=memtrack
+# Install tool
+robo_config --create-tool $NAME libmemtrack.so dynamic
+# Use tool -- used at startup
+robo_config --register-tool $NAME
+# Register errors
+robo_config --register-error 1 $NAME
+robo_config --register-error 4 $NAME
+
+NAME=sanitizer
+# Install tool
+robo_config --create-tool $NAME libsanitizer.so dynamic
+# Use tool -- used at startup
+robo_config --register-tool $NAME
+# Register errors -- 3 (uninitialized) only with "-cc=clang": gcc has no
+# MemorySanitizer
+robo_config --register-error 1 $NAME
+robo_config --register-error 2 $NAME
+robo_config --register-error 5 $NAME
+robo_config --register-error 19 $NAME
+
 NAME=valgrind
 # Install tool
 robo_config --create-tool $NAME libvalgrind.so dynamic
 # Use tool -- used at startup
 robo_config --register-tool $NAME
+# Run only when memtrack reported errors
+robo_config --set-tool-fallback memtrack $NAME
 # Register parameters used when tool is running
 robo_config --register-parameter --trace-children=yes $NAME
 robo_config --register-parameter --track-fds=yes $NAME
-# Register errors
-robo_config --register-error 2 $NAME
+# Register errors -- only memtrack's: drmemory and sanitizer check the others
 robo_config --register-error 1 $NAME
-robo_config --register-error 3 $NAME
 robo_config --register-error 4 $NAME
-robo_config --register-error 19 $NAME
 
 NAME=splint
 # Install tool
@@ -98,11 +121,27 @@ robo_config --register-error 2 $NAME
 robo_config --register-error 3 $NAME
 robo_config --register-error 13 $NAME
 
+NAME=locktrack
+# Install tool
+robo_config --create-tool $NAME liblocktrack.so dynamic
+# Use tool -- used at startup
+robo_config --register-tool $NAME
+# Skip the tool for executables that do not use threads
+robo_config --set-tool-requirement threads $NAME
+# Register errors
+robo_config --register-error 6 $NAME
+robo_config --register-error 7 $NAME
+robo_config --register-error 8 $NAME
+robo_config --register-error 9 $NAME
+robo_config --register-error 10 $NAME
+
 NAME=helgrind
 # Install tool
 robo_config --create-tool $NAME libhelgrind.so dynamic
 # Use tool -- used at startup
 robo_config --register-tool $NAME
+# Skip the tool for executables that do not use threads
+robo_config --set-tool-requirement threads $NAME
 # Register errors
 robo_config --register-error 5 $NAME
 robo_config --register-error 6 $NAME
@@ -112,11 +151,20 @@ robo_config --register-error 9 $NAME
 robo_config --register-error 10 $NAME
 
 NAME=simian
-# Install tool
+# Install tool -- replaced at startup by duplicate, which needs no JVM
 robo_config --create-tool $NAME libsimian.so static
+# Register parameters used when tool is running
+robo_config --register-parameter -language=C $NAME
+robo_config --register-parameter -threshold=4 $NAME
+# Register errors
+robo_config --register-error 11 $NAME
+
+NAME=duplicate
+# Install tool
+robo_config --create-tool $NAME libduplicate.so static
 # Use tool -- used at startup
 robo_config --register-tool $NAME
-# Register parameters used when tool is running
+# Register parameters used when tool is running (simian's)
 robo_config --register-parameter -language=C $NAME
 robo_config --register-parameter -threshold=4 $NAME
 # Register errors
@@ -129,12 +177,25 @@ robo_config --create-tool $NAME libsparse.so static
 robo_config --register-tool $NAME
 # Register parameters used when tool is running
 robo_config --register-parameter "-c" $NAME
+# one analyzer worker: -j 0 would fork one per processor from the process
+# that loaded librobocheck
+robo_config --register-parameter "-j 1" $NAME
+# evaluate only the function bodies, not the header declarations
+robo_config --register-parameter "-f" $NAME
+# Register errors
+robo_config --register-error 14 $NAME
+
+NAME=style
+# Install tool
+robo_config --create-tool $NAME libstyle.so static
+# Use tool -- used at startup
+robo_config --register-tool $NAME
+# Register parameters used when tool is running
 robo_config --register-parameter "-l 150" $NAME
 robo_config --register-parameter "-i 5" $NAME
 robo_config --register-parameter "-s trailing" $NAME
 robo_config --register-parameter "-s mixed-begin" $NAME
 # Register errors
-robo_config --register-error 14 $NAME
 robo_config --register-error 15 $NAME
 robo_config --register-error 16 $NAME
 robo_config --register-error 17 $NAME
@@ -0,0 +1,159 @@
+#ifndef RBC_PRELOAD_H_
+#define RBC_PRELOAD_H_
+
+/*
+ * Helpers shared by the interposition libraries that modules preload into
+ * the tested executable (LD_PRELOAD). Every helper avoids the allocator and
+ * stdio, so they can be called from inside the wrapped functions.
+ *
+ * A trace log holds one record per line:
+ *	<KIND> <detail> <object>+0x<offset> ...
+ * where each frame is a return address given relative to the load base of
+ * the object it belongs to (absolute for ET_EXEC images), already adjusted
+ * to point inside the call instruction. The log is parsed by the module
+ * through parse_trace_logs() from lib/rbc_trace.h.
+ */
+
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE
+#endif
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RBC_TRACE_LOG_ENV	"RBC_TRACE_LOG"
+#define RBC_TRACE_LOG_DEFAULT	"rbc_trace"
+
+#define RBC_MAX_FRAMES		8
+#define RBC_RECORD_MAX		4096
+
+#define RBC_HIDDEN		__attribute__ ((visibility ("hidden")))
+#define RBC_TLS			__thread __attribute__ ((tls_model ("initial-exec")))
+
+/*
+ * rbc_capture_frames
+ *
+ * Records the return addresses of the current call chain.
+ *
+ * returns: the number of frames stored in 'frames'
+ * param1: frames = array of at least RBC_MAX_FRAMES + 2 entries; the two
+ * extra slots absorb the wrapper frames, dropped when the record is written
+ */
+static inline int
+rbc_capture_frames (void **frames)
+{
+	return backtrace(frames, RBC_MAX_FRAMES + 2);
+}
+
+/*
+ * rbc_open_trace_log
+ *
+ * Opens the trace log of the current process: the path given through
+ * RBC_TRACE_LOG_ENV followed by ".<pid>", so that children started by the
+ * tested program do not overwrite the log of their parent.
+ *
+ * returns: file descriptor / -1 on error
+ */
+static int
+rbc_open_trace_log (void)
+{
+	char path[RBC_RECORD_MAX];
+	const char *base = getenv(RBC_TRACE_LOG_ENV);
+
+	if (base == NULL || *base == '\0')
+	{
+		base = RBC_TRACE_LOG_DEFAULT;
+	}
+
+	snprintf(path, sizeof (path), "%s.%d", base, (int) getpid());
+
+	return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+}
+
+static int
+rbc_is_exec_image (const void *base)
+{
+	const unsigned char *ident = (const unsigned char *) base;
+
+	if (ident == NULL || memcmp(ident, ELFMAG, SELFMAG) != 0)
+	{
+		return 0;
+	}
+
+	/* e_type is at the same offset for both classes */
+	return ((const Elf64_Ehdr *) base)->e_type == ET_EXEC;
+}
+
+/*
+ * rbc_write_record
+ *
+ * Writes one record to the trace log. Frames that belong to the
+ * interposition library itself are dropped.
+ *
+ * returns: (nothing)
+ * param1: fd = the trace log
+ * param2: kind = record type (e.g. LEAK)
+ * param3: detail = one word describing the record (e.g. the block size)
+ * param4: frames = return addresses captured by rbc_capture_frames
+ * param5: count = the number of frames
+ */
+static void
+rbc_write_record (int fd, const char *kind, const char *detail, void **frames, int count)
+{
+	char record[RBC_RECORD_MAX];
+	size_t len;
+	Dl_info self, info;
+	int i, written = 0;
+
+	if (fd < 0)
+	{
+		return;
+	}
+
+	if (dladdr((void *) rbc_write_record, &self) == 0)
+	{
+		self.dli_fbase = NULL;
+	}
+
+	len = snprintf(record, sizeof (record), "%s %s", kind, detail);
+	for (i = 0; i < count && written < RBC_MAX_FRAMES && len < sizeof (record); i++)
+	{
+		unsigned long offset;
+
+		if (dladdr(frames[i], &info) == 0 || info.dli_fname == NULL)
+		{
+			continue;
+		}
+
+		if (info.dli_fbase == self.dli_fbase)
+		{
+			continue;
+		}
+
+		offset = (unsigned long) frames[i] - 1;
+		if (!rbc_is_exec_image(info.dli_fbase))
+		{
+			offset -= (unsigned long) info.dli_fbase;
+		}
+
+		len += snprintf(record + len, sizeof (record) - len, " %s+0x%lx",
+				info.dli_fname, offset);
+		written++;
+	}
+
+	if (len >= sizeof (record) - 1)
+	{
+		len = sizeof (record) - 2;
+	}
+
+	record[len++] = '\n';
+	write(fd, record, len);
+}
+
+#endif
@@ -3,11 +3,15 @@
 #define RBC_STATIC_TOOL_H_
 
 #include "../lib/tool.h"
+#include "../lib/rbc_source.h"
 
 struct rbc_static_input
 {
        const char **file_names;
        int file_count;
+
+       /* the loaded sources, in the order of file_names (may be NULL) */
+       struct rbc_source *sources;
 };
 
 #endif
@@ -0,0 +1,22 @@
+
+#ifndef RBC_ELF_H_
+#define RBC_ELF_H_
+
+/*
+ * Capabilities a dynamic tool may require from the tested executable
+ * (declared in rbc_config.xml as requires="threads").
+ */
+#define RBC_CAP_NONE		0x0U
+#define RBC_CAP_THREADS		0x1U
+#define RBC_CAP_ALL		(~RBC_CAP_NONE)
+
+unsigned int
+get_capability (const char *);
+
+const char *
+get_capability_name (unsigned int );
+
+unsigned int
+inspect_executable (const char *);
+
+#endif
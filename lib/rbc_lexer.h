@@ -0,0 +1,39 @@
+#ifndef RBC_LEXER_H_
+#define RBC_LEXER_H_
+
+enum EN_token_type
+{
+	TOK_IDENTIFIER,
+	TOK_KEYWORD,
+	TOK_NUMBER,
+	TOK_STRING,
+	TOK_CHARACTER,
+	TOK_PUNCTUATOR,
+	TOK_DIRECTIVE		// a whole preprocessor line, continuations included
+};
+
+/*
+ * Tokens point into the buffer given to tokenize_source(), which must
+ * outlive them. Comments and white space produce no tokens.
+ */
+struct rbc_token
+{
+	enum EN_token_type type;
+	const char *text;
+	int len;
+	int line;
+};
+
+struct rbc_token_list
+{
+	struct rbc_token *tokens;
+	int count, size;
+};
+
+int
+tokenize_source (const char *, const char *, struct rbc_token_list *);
+
+void
+free_token_list (struct rbc_token_list *);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef RBC_SOURCE_H_
+#define RBC_SOURCE_H_
+
+#include "rbc_lexer.h"
+
+/*
+ * A source loaded once by the core and shared, read only, by every
+ * in-process module. The contents are not NUL terminated. Line n
+ * (counted from 1) begins at data + line_offsets[n - 1].
+ */
+struct rbc_source
+{
+	const char *data;
+	long size;
+
+	long *line_offsets;
+	int line_count;
+
+	struct rbc_token_list tokens;	// built by get_source_tokens()
+	int tokenized;			// 0 - not yet /1 - built /-1 - failed
+
+	int mapped;
+};
+
+struct rbc_source *
+load_sources (const char **, int );
+
+void
+free_sources (struct rbc_source *, int );
+
+const struct rbc_token_list *
+get_source_tokens (struct rbc_source *);
+
+#endif
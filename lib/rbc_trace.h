@@ -0,0 +1,25 @@
+
+#ifndef RBC_TRACE_H_
+#define RBC_TRACE_H_
+
+#include "../include/dynamic_tool.h"
+
+/*
+ * Maps a record kind written by an interposition library (see
+ * include/rbc_preload.h) to the error it reports. Tables are terminated
+ * by an entry with a NULL kind.
+ */
+struct rbc_trace_kind
+{
+	const char *kind;
+	enum EN_err_type err_type;
+};
+
+int
+run_preloaded (struct rbc_input *, const char *, const char *);
+
+int
+parse_trace_logs (const char *, const struct rbc_trace_kind *, struct rbc_dynamic_input *,
+		  rbc_errset_t , struct rbc_output **);
+
+#endif
@@ -61,7 +61,7 @@ run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count);
  * param2: node = the data structure containing information
  * about the currently processed error
  */
-inline void 
+static inline void 
 add (struct rbc_output **list, struct rbc_output node)
 {
 	struct rbc_output *q = NULL, *p = *list;
@@ -22,6 +22,17 @@
 		#define popen _popen
 		#define pclose _pclose
 	#endif
+#else
+	#include <errno.h>
+	#include <dirent.h>
+	#include <time.h>
+	#include <unistd.h>
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/wait.h>
+	#ifdef __linux__
+		#include <sys/prctl.h>
+	#endif
 #endif
 
 #include "../../include/dynamic_tool.h"
@@ -39,6 +50,24 @@
 #define STDERR_TO_STDOUT " 2>&1 "
 #define SEPARATORS "[]"
 
+/*
+ * The symbol cache directory drmemory is given and the size it is kept
+ * under, in KB: the second argument belongs to the module.
+ */
+#define SYMCACHE_DIR_ARG "-symcache_dir"
+#define SYMCACHE_CAP_ARG "-symcache_cap"
+/* temporary cache files younger than this (seconds) are still written */
+#define SYMCACHE_TMP_AGE 3600
+
+/* drmemory and every process it started */
+struct tool_process
+{
+	FILE *out;
+#ifndef _WIN32
+	pid_t runner;
+#endif
+};
+
 /*
  * Get function name.
  * Format:
@@ -303,10 +332,235 @@ static void remove_output_dir (char *name)
 	system(command);
 }
 
+/* Returns the value of an argument such as "-name value" or NULL. */
+static const char *
+get_arg_value (struct rbc_input *input, const char *name)
+{
+	const char *p = NULL;
+	int i;
+
+	for (i = 0; i < input->args_count; i++) {
+		if (strncmp(input->tool_args[i], name, strlen(name)) != 0)
+			continue;
+
+		p = input->tool_args[i] + strlen(name);
+		if (*p != ' ' && *p != '\t')
+			continue;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		return p;
+	}
+
+	return NULL;
+}
+
+#ifndef _WIN32
+struct symcache_file
+{
+	char *name;
+	off_t size;
+	time_t mtime;
+};
+
+static int
+compare_mtime (const void *a, const void *b)
+{
+	const struct symcache_file *fa = a, *fb = b;
+
+	return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+/*
+ * prune_symcache
+ *
+ * Removes the least recently used files of the symbol cache until it
+ * fits in cap bytes: drmemory refreshes the mtime of a file it reads, so
+ * the libraries every run loads stay. drmemory renames a complete file
+ * over the old one, so a run that loses a file it was about to read only
+ * misses the cache; the temporary files of the writers are left alone
+ * unless stale.
+ *
+ * returns: (nothing)
+ * param1: dir = the symbol cache directory
+ * param2: cap = the size of the cache, in bytes
+ */
 static void
-wait_end_of_writing (char *filename)
+prune_symcache (const char *dir, off_t cap)
+{
+	char path[LINE_MAX];
+	struct symcache_file *files = NULL, *temp = NULL;
+	struct dirent *entry;
+	struct stat st;
+	int count = 0, size = 0, i;
+	off_t total = 0;
+	time_t now = time(NULL);
+	DIR *d;
+
+	d = opendir(dir);
+	if (d == NULL)
+		return;
+
+	while ((entry = readdir(d)) != NULL) {
+		snprintf(path, LINE_MAX, "%s/%s", dir, entry->d_name);
+		if (stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+			continue;
+
+		total += st.st_size;
+		if (strstr(entry->d_name, ".tmp") != NULL && now - st.st_mtime < SYMCACHE_TMP_AGE)
+			continue;
+
+		if (count == size) {
+			size = (size != 0) ? 2 * size : 64;
+			temp = realloc(files, size * sizeof(*files));
+			if (temp == NULL)
+				break;
+			files = temp;
+		}
+		files[count].name = strdup(path);
+		files[count].size = st.st_size;
+		files[count].mtime = st.st_mtime;
+		count++;
+	}
+	closedir(d);
+
+	qsort(files, count, sizeof(*files), compare_mtime);
+	for (i = 0; i < count; i++) {
+		if (total > cap && unlink(files[i].name) == 0)
+			total -= files[i].size;
+		free(files[i].name);
+	}
+	free(files);
+}
+
+/*
+ * prepare_symcache
+ *
+ * Creates the symbol cache directory, private to the user, and keeps it
+ * under its size cap. The symbols read from the cache are trusted, so a
+ * directory another user owns or can write to is not used.
+ *
+ * returns: 0 - the directory can be given to drmemory /-1 - otherwise
+ * param1: input = the tool input (parameters)
+ */
+static int
+prepare_symcache (struct rbc_input *input)
 {
+	char dir[LINE_MAX];
+	const char *value;
+	struct stat st;
+
+	value = get_arg_value(input, SYMCACHE_DIR_ARG);
+	if (value == NULL)
+		return 0;
+	snprintf(dir, LINE_MAX, "%s", value);
+	trim_whitespace(dir);
+
+	if (mkdir(dir, 0700) == -1 && errno != EEXIST)
+		return -1;
+
+	if (lstat(dir, &st) == -1 || !S_ISDIR(st.st_mode) ||
+	    st.st_uid != getuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+		log_message("Drmemory symbol cache directory is not private to the user, not used.", stderr);
+		return -1;
+	}
+
+	value = get_arg_value(input, SYMCACHE_CAP_ARG);
+	if (value != NULL && atol(value) > 0)
+		prune_symcache(dir, (off_t) atol(value) * 1024);
+
+	return 0;
+}
+#endif
+
 #ifndef _WIN32
+/*
+ * start_tool
+ *
+ * Runs command through the shell under a runner process, which adopts
+ * every process the command leaves behind and exits only after all of
+ * them did: the front end of drmemory returns before the instrumented
+ * program stops writing the results. Where the runner cannot be a child
+ * subreaper (no PR_SET_CHILD_SUBREAPER, before Linux 3.4), it waits for
+ * the command only and end_tool() says so.
+ *
+ * returns: 0 - success / -1 - the command could not be started
+ * param1: command = the command line
+ * param2: tool = the output (stdout) and the runner of the command
+ */
+static int
+start_tool (const char *command, struct tool_process *tool)
+{
+	int fds[2], reaper = 0;
+	pid_t pid;
+
+	if (pipe(fds) == -1)
+		return -1;
+
+	tool->runner = fork();
+	if (tool->runner == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+
+	if (tool->runner == 0) {
+		close(fds[0]);
+#ifdef PR_SET_CHILD_SUBREAPER
+		reaper = (prctl(PR_SET_CHILD_SUBREAPER, 1) == 0);
+#endif
+		pid = fork();
+		if (pid == 0) {
+			dup2(fds[1], STDOUT_FILENO);
+			close(fds[1]);
+			execl("/bin/sh", "sh", "-c", command, (char *) NULL);
+			_exit(127);
+		}
+		close(fds[1]);
+
+		/* the command and the orphans it leaves, until none is left */
+		while (pid != -1 && (wait(NULL) != -1 || errno == EINTR));
+		_exit((pid == -1) ? 1 : reaper ? 0 : 2);
+	}
+
+	close(fds[1]);
+	tool->out = fdopen(fds[0], "r");
+	if (tool->out == NULL) {
+		close(fds[0]);
+		waitpid(tool->runner, NULL, 0);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * end_tool
+ *
+ * Waits until drmemory and the processes it started have all ended.
+ *
+ * returns: 0 - they ended / 1 - those drmemory left may still run
+ * param1: tool = the tool started by start_tool
+ */
+static int
+end_tool (struct tool_process *tool)
+{
+	int status = 0;
+
+	fclose(tool->out);
+	while (waitpid(tool->runner, &status, 0) == -1)
+		if (errno != EINTR)
+			return 1;
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == 2;
+}
+
+/*
+ * Without a subreaper the instrumented program is not waited for: its
+ * results are complete once no process holds them open.
+ */
+static void
+wait_end_of_writing (char *filename)
+{
 	FILE *in = NULL;
 	char line[LINE_MAX];
 	char command[LINE_MAX];
@@ -316,6 +570,8 @@ wait_end_of_writing (char *filename)
 
 	while (1) {
 		in = popen(command, "r");
+		if (in == NULL)
+			break;
 
 		memset(line, 0, LINE_MAX);
 		fgets(line, LINE_MAX, in);
@@ -325,9 +581,26 @@ wait_end_of_writing (char *filename)
 
 		if (strlen(line) == 0)
 			break;
+		usleep(100000);
 	}
-#endif
 }
+#else
+static int
+start_tool (const char *command, struct tool_process *tool)
+{
+	tool->out = popen(command, "r");
+
+	return (tool->out != NULL) ? 0 : -1;
+}
+
+static int
+end_tool (struct tool_process *tool)
+{
+	pclose(tool->out);
+
+	return 0;
+}
+#endif
 
 void modify_name_path(char *str)
 {
@@ -355,15 +628,25 @@ run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count)
 	char command[LINE_MAX] = DEFAULT_CMD;
 	struct rbc_output *output = NULL;
 	struct rbc_dynamic_input *dynamic_input = NULL;
-	FILE *out_stream, *results;
-	int i;
+	struct tool_process tool;
+	FILE *results;
+	int i, orphans, use_symcache = 1;
 
 	if (input != NULL && input->input_ptr != NULL &&
 	    input->tool_type == DYNAMIC_TOOL) {
 		dynamic_input = (struct rbc_dynamic_input *)input->input_ptr;
 
-		/* Add command line arguments. */
+#ifndef _WIN32
+		use_symcache = (prepare_symcache(input) == 0);
+#endif
+
+		/* Add command line arguments; without its directory drmemory keeps the cache in the logs. */
 		for (i = 0; i < input->args_count; i++) {
+			if (strncmp(input->tool_args[i], SYMCACHE_CAP_ARG, strlen(SYMCACHE_CAP_ARG)) == 0)
+				continue;
+			if (!use_symcache &&
+			    strncmp(input->tool_args[i], SYMCACHE_DIR_ARG, strlen(SYMCACHE_DIR_ARG)) == 0)
+				continue;
 			strcat(command, input->tool_args[i]);
 			strcat(command, SPACE);
 		}
@@ -373,27 +656,29 @@ run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count)
 		strcat(command, STDERR_TO_STDOUT);
 
 		/* Run tool. */
-		out_stream = popen(command, "r");
-		if (out_stream == NULL)
+		if (start_tool(command, &tool) != 0)
 			return NULL;
 
-		/* Get results file name. */
-		while (!feof(out_stream)) {
-			fgets(line, LINE_MAX, out_stream);
-			if (strncmp(line, DETAILS, strlen(DETAILS)) == 0) {
+		/* Get results file name; the rest is read so that the tool does not block. */
+		while (fgets(line, LINE_MAX, tool.out) != NULL) {
+			if (name == NULL && strncmp(line, DETAILS, strlen(DETAILS)) == 0) {
 				name = calloc(LINE_MAX, sizeof(char));
 				strcpy(name, line + strlen(DETAILS));
 				trim_whitespace(name);
-				break;
 			}
 		}
 
+		/* The results are complete once every process of the tool ended. */
+		orphans = end_tool(&tool);
+
 		if (name == NULL)
 			return NULL;
 		modify_name_path(name);
 
-		wait_end_of_writing(name);
-		pclose(out_stream);
+#ifndef _WIN32
+		if (orphans)
+			wait_end_of_writing(name);
+#endif
 
 		/* Open output file. */
 		results = fopen(name, "r");
@@ -0,0 +1,466 @@
+/*
+ * rbc_duplicate.c: Duplicate code module
+ *
+ * General description:
+ *	Checks for duplicate code without running simian (and a JVM).
+ * Sources are tokenized once by the robocheck core, every line of
+ * code is reduced to a hash of its normalized tokens and windows of
+ * threshold consecutive lines are compared through a rolling hash. Each
+ * window that repeats an earlier one is extended to the longest common
+ * region, which is reported with the message of the simian module:
+ *	Duplicate lines: file[from-to]  file[from-to]
+ *	Parameters (named as the simian ones, others are ignored):
+ *	-threshold=<lines>	the smallest duplicate reported (default 6)
+ *	-ignoreIdentifiers	identifiers are considered equal
+ *	-ignoreStrings		string literals are considered equal
+ *	-ignoreNumbers		numbers are considered equal
+ *	-ignoreCharacters	character literals are considered equal
+ *	-ignoreLiterals		all of the three above
+ *	-ignoreCurlyBraces	braces are not part of the compared lines
+ */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/static_tool.h"
+#include "../../lib/rbc_lexer.h"
+
+#define MSG_SIZE 4096
+#define THRESHOLD_PARAM "-threshold="
+#define DEFAULT_THRESHOLD 6
+#define INCLUDE "include"
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define WINDOW_BASE 1000003ULL
+
+#define IGNORE_IDENTIFIERS	0x01
+#define IGNORE_STRINGS		0x02
+#define IGNORE_NUMBERS		0x04
+#define IGNORE_CHARACTERS	0x08
+#define IGNORE_BRACES		0x10
+
+typedef unsigned long long hash_t;
+
+struct dup_options
+{
+	const char *name;
+	unsigned int mask;
+};
+
+static const struct dup_options options[] =
+{
+	{"-ignoreIdentifiers", IGNORE_IDENTIFIERS},
+	{"-ignoreStrings", IGNORE_STRINGS},
+	{"-ignoreNumbers", IGNORE_NUMBERS},
+	{"-ignoreCharacters", IGNORE_CHARACTERS},
+	{"-ignoreLiterals", IGNORE_STRINGS | IGNORE_NUMBERS | IGNORE_CHARACTERS},
+	{"-ignoreCurlyBraces", IGNORE_BRACES},
+	{NULL, 0}
+};
+
+/* A line of code of one of the sources, reduced to a hash. */
+struct dup_line
+{
+	int file;
+	int line;
+	hash_t hash;
+};
+
+struct dup_source
+{
+	struct dup_line *lines;
+	int count, size;
+};
+
+/* The copy of the lines starting at orig, found at copy. */
+struct dup_region
+{
+	int orig, copy, len;
+};
+
+/*
+ * get_options
+ *
+ * Reads the parameters of the module.
+ *
+ * returns: the normalizations to apply (IGNORE_* mask)
+ * param1: input = the tool input (parameters)
+ * param2: threshold = will be filled with the smallest duplicate reported
+ */
+
+static unsigned int
+get_options (struct rbc_input *input, int *threshold){
+	unsigned int mask = 0;
+	int i, j;
+
+	*threshold = DEFAULT_THRESHOLD;
+	for (i = 0; i < input->args_count; i++){
+		if (input->tool_args[i] == NULL)
+			continue;
+
+		if (strncmp(input->tool_args[i], THRESHOLD_PARAM, strlen(THRESHOLD_PARAM)) == 0){
+			*threshold = atoi(input->tool_args[i] + strlen(THRESHOLD_PARAM));
+			continue;
+		}
+
+		for (j = 0; options[j].name != NULL; j++){
+			if (strcmp(input->tool_args[i], options[j].name) == 0)
+				mask |= options[j].mask;
+		}
+	}
+
+	if (*threshold < 1)
+		*threshold = 1;
+
+	return mask;
+}
+
+static hash_t
+hash_bytes (hash_t hash, const char *text, int len){
+	int i;
+
+	for (i = 0; i < len; i++){
+		hash ^= (unsigned char) text[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static int
+is_include (const struct rbc_token *token){
+	const char *p = token->text + 1, *end = token->text + token->len;
+
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+
+	return end - p >= (int) strlen(INCLUDE) && strncmp(p, INCLUDE, strlen(INCLUDE)) == 0;
+}
+
+/*
+ * hash_token
+ *
+ * Adds a token to the hash of its line, as configured.
+ *
+ * returns: the new hash of the line /the old one if the token is ignored
+ * param1: hash = the hash of the line so far
+ * param2: token = the token
+ * param3: mask = the normalizations to apply
+ */
+
+static hash_t
+hash_token (hash_t hash, const struct rbc_token *token, unsigned int mask){
+	const char *text = token->text;
+	int len = token->len;
+
+	switch (token->type){
+	case TOK_IDENTIFIER:
+		if (mask & IGNORE_IDENTIFIERS)
+			text = "$id";
+		break;
+	case TOK_STRING:
+		if (mask & IGNORE_STRINGS)
+			text = "$str";
+		break;
+	case TOK_NUMBER:
+		if (mask & IGNORE_NUMBERS)
+			text = "$num";
+		break;
+	case TOK_CHARACTER:
+		if (mask & IGNORE_CHARACTERS)
+			text = "$chr";
+		break;
+	case TOK_PUNCTUATOR:
+		if ((mask & IGNORE_BRACES) && len == 1 && (*text == '{' || *text == '}'))
+			return hash;
+		break;
+	case TOK_DIRECTIVE:
+		/* the same headers are included everywhere */
+		if (is_include(token))
+			return hash;
+		break;
+	default:
+		break;
+	}
+
+	if (text != token->text)
+		len = strlen(text);
+
+	/* the separator keeps "a b" and "ab" apart */
+	return hash_bytes(hash, text, len) ^ ' ';
+}
+
+static int
+add_line (struct dup_source *source, int file, int line, hash_t hash){
+	struct dup_line *temp;
+
+	if (source->count == source->size){
+		source->size = source->size ? 2 * source->size : ALLOC_INC;
+		temp = (struct dup_line *) realloc(source->lines, source->size * sizeof (struct dup_line));
+		if (temp == NULL)
+			return -1;
+		source->lines = temp;
+	}
+
+	source->lines[source->count].file = file;
+	source->lines[source->count].line = line;
+	source->lines[source->count].hash = hash;
+	source->count++;
+
+	return 0;
+}
+
+/*
+ * hash_lines
+ *
+ * Reduces the lines of code of a source to hashes of their normalized
+ * tokens. Lines without tokens (blank, comments, ignored tokens) are
+ * skipped.
+ *
+ * returns: 0 - success /-1 - the source could not be split in tokens
+ * param1: loaded = the source, as loaded by the core
+ * param2: file = the index of the source
+ * param3: mask = the normalizations to apply
+ * param4: source = the lines of code of all the sources
+ */
+
+static int
+hash_lines (struct rbc_source *loaded, int file, unsigned int mask, struct dup_source *source){
+	const struct rbc_token_list *tokens;
+	hash_t hash = FNV_OFFSET;
+	int i, line = 0, status = 0;
+
+	tokens = get_source_tokens(loaded);
+	if (tokens == NULL)
+		return -1;
+
+	for (i = 0; i < tokens->count && status == 0; i++){
+		if (tokens->tokens[i].line != line){
+			if (hash != FNV_OFFSET)
+				status = add_line(source, file, line, hash);
+			hash = FNV_OFFSET;
+			line = tokens->tokens[i].line;
+		}
+		hash = hash_token(hash, &tokens->tokens[i], mask);
+	}
+	if (hash != FNV_OFFSET && status == 0)
+		status = add_line(source, file, line, hash);
+
+	return status;
+}
+
+static int
+same_file (struct dup_source *source, int i, int j){
+	return source->lines[i].file == source->lines[j].file;
+}
+
+/*
+ * extend_region
+ *
+ * Extends a duplicate window as long as the lines of both copies match,
+ * without running into the next source or into the copy itself.
+ *
+ * returns: the number of lines of the region
+ * param1: source = the lines of code of all the sources
+ * param2: orig, copy = where the two copies begin (orig < copy)
+ * param3: len = the number of lines known to match
+ */
+
+static int
+extend_region (struct dup_source *source, int orig, int copy, int len){
+	while (copy + len < source->count
+		&& same_file(source, copy, copy + len)
+		&& same_file(source, orig, orig + len)
+		&& (!same_file(source, orig, copy) || orig + len < copy)
+		&& source->lines[orig + len].hash == source->lines[copy + len].hash)
+		len++;
+
+	return len;
+}
+
+/*
+ * find_regions
+ *
+ * Compares every window of threshold lines with the first window that
+ * had the same hash. Windows are hashed with a polynomial rolling hash,
+ * so each line is looked at a constant number of times.
+ *
+ * returns: the number of regions found
+ * param1: source = the lines of code of all the sources
+ * param2: threshold = the number of lines of a window
+ * param3: regions = will hold the regions found (to be freed)
+ */
+
+static int
+find_regions (struct dup_source *source, int threshold, struct dup_region **regions){
+	hash_t window = 0, power = 1;
+	hash_t *keys = NULL;
+	int *first = NULL, *covered = NULL;
+	int i, j, k, c, slot, start = 0, slots, count = 0, size = 0, len;
+	struct dup_region *temp;
+
+	*regions = NULL;
+	if (source->count < threshold)
+		return 0;
+
+	for (slots = 1; slots < 2 * source->count; slots <<= 1)
+		;
+	keys = (hash_t *) malloc(slots * sizeof (hash_t));
+	first = (int *) malloc(slots * sizeof (int));
+	covered = (int *) calloc(source->count, sizeof (int));
+	if (keys == NULL || first == NULL || covered == NULL)
+		goto exit;
+	memset(first, -1, slots * sizeof (int));
+
+	for (k = 1; k < threshold; k++)
+		power *= WINDOW_BASE;
+
+	for (k = 0; k < source->count; k++){
+		/* windows do not span two sources */
+		if (!same_file(source, start, k)){
+			start = k;
+			window = 0;
+		}
+
+		if (k - start >= threshold)
+			window -= source->lines[k - threshold].hash * power;
+		window = window * WINDOW_BASE + source->lines[k].hash;
+		if (k - start + 1 < threshold)
+			continue;
+
+		i = k - threshold + 1;
+		for (slot = (int) (window & (slots - 1)); first[slot] != -1 && keys[slot] != window; )
+			slot = (slot + 1) & (slots - 1);
+
+		if (first[slot] == -1){
+			keys[slot] = window;
+			first[slot] = i;
+			continue;
+		}
+
+		j = first[slot];
+		if (covered[i] || (same_file(source, i, j) && j + threshold > i))
+			continue;
+
+		/* a hash collision is not a duplicate */
+		for (len = 0; len < threshold && source->lines[i + len].hash == source->lines[j + len].hash; len++)
+			;
+		if (len < threshold)
+			continue;
+
+		/* the windows inside the copy are part of the same region */
+		len = extend_region(source, j, i, len);
+		for (c = i; c <= i + len - threshold; c++)
+			covered[c] = 1;
+
+		if (count == size){
+			size = size ? 2 * size : ALLOC_INC;
+			temp = (struct dup_region *) realloc(*regions, size * sizeof (struct dup_region));
+			if (temp == NULL)
+				break;
+			*regions = temp;
+		}
+		(*regions)[count].orig = j;
+		(*regions)[count].copy = i;
+		(*regions)[count].len = len;
+		count++;
+	}
+
+exit:
+	free(keys);
+	free(first);
+	free(covered);
+
+	return count;
+}
+
+static int
+cmp_regions (const void *a, const void *b){
+	const struct dup_region *r1 = (const struct dup_region *) a;
+	const struct dup_region *r2 = (const struct dup_region *) b;
+
+	if (r1->orig != r2->orig)
+		return r1->orig - r2->orig;
+	if (r1->len != r2->len)
+		return r1->len - r2->len;
+	return r1->copy - r2->copy;
+}
+
+static void
+append_block (char *message, struct dup_source *source, struct rbc_static_input *static_input,
+	      int first, int len){
+	size_t used = strlen(message);
+
+	snprintf(message + used, MSG_SIZE - used, " %s[%d-%d] ",
+		 static_input->file_names[source->lines[first].file],
+		 source->lines[first].line, source->lines[first + len - 1].line);
+}
+
+/*
+ * run_tool (every module contains this function)
+ *
+ * Looks for duplicate code in the sources. Copies of the same region
+ * are reported together, in one error.
+ *
+ * returns: the list of errors detected by the tool
+ * param1: input = pointer to the information required by the
+ * tool (sources and/or executables)
+ * param2: flags = a bit set that indicates what errors are tracked
+ * at the moment of usage
+ * param3: err_count = will hold the number of errors detected
+ */
+
+struct rbc_output *
+run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count){
+	char message[MSG_SIZE];
+	struct rbc_static_input *static_input = NULL;
+	struct rbc_output *output = NULL;
+	struct rbc_output node;
+	struct dup_source source = {NULL, 0, 0};
+	struct dup_region *regions = NULL;
+	unsigned int mask;
+	int i, count, threshold;
+
+	*err_count = 0;
+	if (!ISSET_ERR(ERR_DUPLICATE_CODE, flags))
+		return NULL;
+	if (input == NULL || input->input_ptr == NULL || input->tool_type != STATIC_TOOL)
+		return NULL;
+
+	static_input = (struct rbc_static_input *) input->input_ptr;
+	mask = get_options(input, &threshold);
+
+	for (i = 0; i < static_input->file_count; i++){
+		if (static_input->sources == NULL
+			|| hash_lines(&static_input->sources[i], i, mask, &source) != 0){
+			snprintf(message, MSG_SIZE, "Duplicate: could not read %s.", static_input->file_names[i]);
+			log_message(message, stderr);
+		}
+	}
+
+	count = find_regions(&source, threshold, &regions);
+	qsort(regions, count, sizeof (struct dup_region), cmp_regions);
+
+	for (i = 0; i < count; i++){
+		if (i == 0 || regions[i].orig != regions[i - 1].orig || regions[i].len != regions[i - 1].len){
+			strcpy(message, "Duplicate lines:");
+			append_block(message, &source, static_input, regions[i].orig, regions[i].len);
+		}
+		append_block(message, &source, static_input, regions[i].copy, regions[i].len);
+
+		if (i + 1 == count || regions[i + 1].orig != regions[i].orig || regions[i + 1].len != regions[i].len){
+			node.err_type = ERR_DUPLICATE_CODE;
+			node.err_msg = strdup(message);
+			add(&output, node);
+		}
+	}
+	*err_count = (output != NULL) ? output->size : 0;
+
+	free(regions);
+	free(source.lines);
+
+	return output;
+}
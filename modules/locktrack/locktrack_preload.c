@@ -0,0 +1,700 @@
+/*
+ * locktrack_preload.c: interposition library used by the locktrack module
+ *
+ * General description:
+ *	Preloaded into the tested executable. Wraps the pthread mutex and
+ * condition variable API and checks, using lock events only:
+ *	- the order in which locks are taken: every time a thread acquires
+ * a lock while holding others, an edge is added to a lock-order graph;
+ * an edge that closes a cycle is a potential dead lock (DEADLOCK)
+ *	- unlocking a mutex the calling thread does not hold (UNLOCK)
+ *	- destroying a locked mutex (DESTROY)
+ *	- threads that exit while holding locks (HOLD)
+ *	- waiting on a condition variable with a mutex the thread does not
+ * hold, or with a different mutex than the other waiters (COND)
+ * Every problem is written to the trace log when it is detected (see
+ * include/rbc_preload.h):
+ *	<KIND> <lock address> <frames>
+ */
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "../../include/rbc_preload.h"
+
+#define MAX_LOCKS	4096
+#define LOCK_SLOTS	(2 * MAX_LOCKS)
+#define MAX_EDGES	16384
+#define MAX_HELD	64
+#define MAX_CONDS	1024
+#define MAX_RECORDS	1024
+
+#define NO_NODE		(-1)
+#define FREED_NODE	(-2)
+
+/* a lock that was seen; the lock-order edges leave from it */
+struct lock_node
+{
+	void *addr;
+	int locked;
+	int first_edge;
+	unsigned int visit;
+};
+
+struct lock_edge
+{
+	int to;
+	int next;
+};
+
+struct held_lock
+{
+	int node;
+	int depth;
+	void *caller;
+};
+
+struct cond_pair
+{
+	void *cond;
+	void *mutex;
+};
+
+struct start_args
+{
+	void *(* routine) (void *);
+	void *arg;
+};
+
+static int (* real_mutex_lock) (pthread_mutex_t *);
+static int (* real_mutex_trylock) (pthread_mutex_t *);
+static int (* real_mutex_timedlock) (pthread_mutex_t *, const struct timespec *);
+static int (* real_mutex_unlock) (pthread_mutex_t *);
+static int (* real_mutex_destroy) (pthread_mutex_t *);
+static int (* real_cond_wait) (pthread_cond_t *, pthread_mutex_t *);
+static int (* real_cond_timedwait) (pthread_cond_t *, pthread_mutex_t *, const struct timespec *);
+static int (* real_cond_destroy) (pthread_cond_t *);
+static int (* real_create) (pthread_t *, const pthread_attr_t *, void *(*) (void *), void *);
+static void (* real_exit) (void *) __attribute__ ((noreturn));
+
+static int initialized;
+
+static volatile int graph_lock;
+static struct lock_node nodes[MAX_LOCKS];
+static int node_count, slots[LOCK_SLOTS];
+static struct lock_edge edges[MAX_EDGES];
+static int edge_count;
+static unsigned int visit_stamp;
+static int dfs_stack[MAX_LOCKS];
+static struct cond_pair conds[MAX_CONDS];
+
+static int log_fd = -1, record_count;
+
+static RBC_TLS struct held_lock held[MAX_HELD];
+static RBC_TLS int held_count;
+
+/*
+ * The condition variable functions exist in two versions; dlsym() would
+ * return the old one.
+ */
+static void *
+next_symbol (const char *name, const char *version)
+{
+	void *sym = NULL;
+
+	if (version != NULL)
+	{
+		sym = dlvsym(RTLD_NEXT, name, version);
+	}
+
+	return (sym != NULL) ? sym : dlsym(RTLD_NEXT, name);
+}
+
+static void
+init_hooks (void)
+{
+	if (initialized)
+	{
+		return;
+	}
+
+	real_mutex_lock = next_symbol("pthread_mutex_lock", NULL);
+	real_mutex_trylock = next_symbol("pthread_mutex_trylock", NULL);
+	real_mutex_timedlock = next_symbol("pthread_mutex_timedlock", NULL);
+	real_mutex_unlock = next_symbol("pthread_mutex_unlock", NULL);
+	real_mutex_destroy = next_symbol("pthread_mutex_destroy", NULL);
+	real_cond_wait = next_symbol("pthread_cond_wait", "GLIBC_2.3.2");
+	real_cond_timedwait = next_symbol("pthread_cond_timedwait", "GLIBC_2.3.2");
+	real_cond_destroy = next_symbol("pthread_cond_destroy", "GLIBC_2.3.2");
+	real_create = next_symbol("pthread_create", NULL);
+	real_exit = next_symbol("pthread_exit", NULL);
+	initialized = 1;
+}
+
+static void
+lock_graph (void)
+{
+	while (__sync_lock_test_and_set(&graph_lock, 1))
+	{
+		while (graph_lock)
+			;
+	}
+}
+
+static void
+unlock_graph (void)
+{
+	__sync_lock_release(&graph_lock);
+}
+
+/* Called with the graph locked; frames are captured only for problems. */
+static void
+report (const char *kind, void *addr, void *caller)
+{
+	void *frames[RBC_MAX_FRAMES + 2];
+	char detail[32];
+	int count;
+
+	if (record_count >= MAX_RECORDS)
+	{
+		return;
+	}
+
+	if (log_fd < 0)
+	{
+		log_fd = rbc_open_trace_log();
+	}
+
+	if (caller != NULL)
+	{
+		frames[0] = caller;
+		count = 1;
+	}
+	else
+	{
+		count = rbc_capture_frames(frames);
+	}
+
+	snprintf(detail, sizeof (detail), "%p", addr);
+	rbc_write_record(log_fd, kind, detail, frames, count);
+	record_count++;
+}
+
+static unsigned int
+hash_addr (void *addr)
+{
+	uintptr_t h = (uintptr_t) addr >> 3;
+
+	h ^= h >> 15;
+	h *= 0x9e3779b1U;
+
+	return h % LOCK_SLOTS;
+}
+
+/*
+ * Finds the node of a lock, creating it if needed.
+ *
+ * returns: the node index / NO_NODE if the table is full
+ */
+static int
+get_node (void *addr, int create)
+{
+	unsigned int i, free_slot = LOCK_SLOTS;
+
+	for (i = hash_addr(addr); slots[i] != 0; i = (i + 1) % LOCK_SLOTS)
+	{
+		if (slots[i] == FREED_NODE)
+		{
+			if (free_slot == LOCK_SLOTS)
+			{
+				free_slot = i;
+			}
+			continue;
+		}
+
+		if (nodes[slots[i] - 1].addr == addr)
+		{
+			return slots[i] - 1;
+		}
+	}
+
+	if (!create || node_count == MAX_LOCKS)
+	{
+		return NO_NODE;
+	}
+
+	if (free_slot == LOCK_SLOTS)
+	{
+		free_slot = i;
+	}
+
+	nodes[node_count].addr = addr;
+	nodes[node_count].locked = 0;
+	nodes[node_count].first_edge = NO_NODE;
+	slots[free_slot] = ++node_count;
+
+	return node_count - 1;
+}
+
+/* A destroyed lock starts with a fresh node if its memory is reused. */
+static void
+forget_node (void *addr)
+{
+	unsigned int i;
+
+	for (i = hash_addr(addr); slots[i] != 0; i = (i + 1) % LOCK_SLOTS)
+	{
+		if (slots[i] != FREED_NODE && nodes[slots[i] - 1].addr == addr)
+		{
+			slots[i] = FREED_NODE;
+			return;
+		}
+	}
+}
+
+/*
+ * Checks whether 'to' can already reach 'from' in the lock-order graph,
+ * in which case the edge from -> to closes a cycle.
+ */
+static int
+reaches (int from, int to)
+{
+	int top = 0, node, edge;
+
+	if (++visit_stamp == 0)
+	{
+		++visit_stamp;
+	}
+
+	dfs_stack[top++] = to;
+	nodes[to].visit = visit_stamp;
+
+	while (top > 0)
+	{
+		node = dfs_stack[--top];
+		if (node == from)
+		{
+			return 1;
+		}
+
+		for (edge = nodes[node].first_edge; edge != NO_NODE; edge = edges[edge].next)
+		{
+			if (nodes[edges[edge].to].visit != visit_stamp)
+			{
+				nodes[edges[edge].to].visit = visit_stamp;
+				dfs_stack[top++] = edges[edge].to;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Adds the edge from -> to, unless it is known.
+ *
+ * returns: 1 if the edge closes a cycle / 0 otherwise
+ */
+static int
+add_edge (int from, int to)
+{
+	int edge, cycle;
+
+	for (edge = nodes[from].first_edge; edge != NO_NODE; edge = edges[edge].next)
+	{
+		if (edges[edge].to == to)
+		{
+			return 0;
+		}
+	}
+
+	cycle = reaches(from, to);
+
+	if (edge_count < MAX_EDGES)
+	{
+		edges[edge_count].to = to;
+		edges[edge_count].next = nodes[from].first_edge;
+		nodes[from].first_edge = edge_count++;
+	}
+
+	return cycle;
+}
+
+static int
+find_held (int node)
+{
+	int i;
+
+	for (i = held_count - 1; i >= 0; i--)
+	{
+		if (held[i].node == node)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Records the order of the locks before blocking on a new one. */
+static void
+before_lock (void *mutex, void *caller)
+{
+	int node, i, cycle = 0;
+
+	lock_graph();
+	node = get_node(mutex, 1);
+	if (node != NO_NODE && find_held(node) < 0)
+	{
+		for (i = 0; i < held_count; i++)
+		{
+			if (held[i].node != NO_NODE)
+			{
+				cycle |= add_edge(held[i].node, node);
+			}
+		}
+
+		if (cycle)
+		{
+			report("DEADLOCK", mutex, caller);
+		}
+	}
+	unlock_graph();
+}
+
+static void
+after_lock (void *mutex, void *caller)
+{
+	int node, i;
+
+	lock_graph();
+	node = get_node(mutex, 1);
+	if (node != NO_NODE)
+	{
+		nodes[node].locked = 1;
+	}
+	unlock_graph();
+
+	i = (node != NO_NODE) ? find_held(node) : -1;
+	if (i >= 0)
+	{
+		held[i].depth++;
+	}
+	else if (node != NO_NODE && held_count < MAX_HELD)
+	{
+		held[held_count].node = node;
+		held[held_count].depth = 1;
+		held[held_count].caller = caller;
+		held_count++;
+	}
+}
+
+/*
+ * returns: 1 if the calling thread holds the lock / 0 otherwise
+ */
+static int
+before_unlock (void *mutex, void *caller)
+{
+	int node, i;
+
+	lock_graph();
+	node = get_node(mutex, 0);
+	if (node == NO_NODE && node_count == MAX_LOCKS)
+	{
+		/* the lock could not be tracked */
+		unlock_graph();
+		return 1;
+	}
+
+	i = (node != NO_NODE) ? find_held(node) : -1;
+	if (i < 0)
+	{
+		report("UNLOCK", mutex, caller);
+		unlock_graph();
+		return 0;
+	}
+
+	if (held[i].depth == 1)
+	{
+		nodes[node].locked = 0;
+	}
+	unlock_graph();
+
+	if (--held[i].depth == 0)
+	{
+		held[i] = held[--held_count];
+	}
+
+	return 1;
+}
+
+/* Checks the pairing of a condition variable with the mutex of a wait. */
+static void
+check_cond (void *cond, void *mutex, void *caller)
+{
+	int i, node, free_slot = -1;
+
+	lock_graph();
+
+	node = get_node(mutex, 0);
+	if (node == NO_NODE || find_held(node) < 0)
+	{
+		report("COND", cond, caller);
+	}
+
+	for (i = 0; i < MAX_CONDS; i++)
+	{
+		if (conds[i].cond == cond)
+		{
+			if (conds[i].mutex != mutex)
+			{
+				report("COND", cond, caller);
+				conds[i].mutex = mutex;
+			}
+			break;
+		}
+
+		if (conds[i].cond == NULL && free_slot < 0)
+		{
+			free_slot = i;
+		}
+	}
+
+	if (i == MAX_CONDS && free_slot >= 0)
+	{
+		conds[free_slot].cond = cond;
+		conds[free_slot].mutex = mutex;
+	}
+
+	unlock_graph();
+}
+
+/* Called when a thread is about to exit, and at process exit. */
+static void
+check_held_locks (void)
+{
+	if (held_count == 0 || held[0].node == NO_NODE)
+	{
+		return;
+	}
+
+	lock_graph();
+	report("HOLD", nodes[held[0].node].addr, held[0].caller);
+	unlock_graph();
+}
+
+int
+pthread_mutex_lock (pthread_mutex_t *mutex)
+{
+	void *caller = __builtin_return_address(0);
+	int ret;
+
+	init_hooks();
+	before_lock(mutex, caller);
+	ret = real_mutex_lock(mutex);
+	if (ret == 0)
+	{
+		after_lock(mutex, caller);
+	}
+
+	return ret;
+}
+
+int
+pthread_mutex_timedlock (pthread_mutex_t *mutex, const struct timespec *abstime)
+{
+	void *caller = __builtin_return_address(0);
+	int ret;
+
+	init_hooks();
+	before_lock(mutex, caller);
+	ret = real_mutex_timedlock(mutex, abstime);
+	if (ret == 0)
+	{
+		after_lock(mutex, caller);
+	}
+
+	return ret;
+}
+
+/* A try lock cannot block, so it does not add lock-order edges. */
+int
+pthread_mutex_trylock (pthread_mutex_t *mutex)
+{
+	int ret;
+
+	init_hooks();
+	ret = real_mutex_trylock(mutex);
+	if (ret == 0)
+	{
+		after_lock(mutex, __builtin_return_address(0));
+	}
+
+	return ret;
+}
+
+int
+pthread_mutex_unlock (pthread_mutex_t *mutex)
+{
+	init_hooks();
+	before_unlock(mutex, __builtin_return_address(0));
+
+	return real_mutex_unlock(mutex);
+}
+
+int
+pthread_mutex_destroy (pthread_mutex_t *mutex)
+{
+	int node, i;
+
+	init_hooks();
+
+	lock_graph();
+	node = get_node(mutex, 0);
+	if (node != NO_NODE && nodes[node].locked)
+	{
+		report("DESTROY", mutex, __builtin_return_address(0));
+	}
+	forget_node(mutex);
+	unlock_graph();
+
+	/* reported as destroyed, not again as held when the thread exits */
+	i = (node != NO_NODE) ? find_held(node) : -1;
+	if (i >= 0)
+	{
+		held[i] = held[--held_count];
+	}
+
+	return real_mutex_destroy(mutex);
+}
+
+int
+pthread_cond_wait (pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+	int ret, node;
+
+	init_hooks();
+	check_cond(cond, mutex, __builtin_return_address(0));
+	ret = real_cond_wait(cond, mutex);
+
+	/* the mutex is owned again when the wait returns */
+	lock_graph();
+	node = get_node(mutex, 0);
+	if (node != NO_NODE)
+	{
+		nodes[node].locked = 1;
+	}
+	unlock_graph();
+
+	return ret;
+}
+
+int
+pthread_cond_timedwait (pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime)
+{
+	int ret, node;
+
+	init_hooks();
+	check_cond(cond, mutex, __builtin_return_address(0));
+	ret = real_cond_timedwait(cond, mutex, abstime);
+
+	lock_graph();
+	node = get_node(mutex, 0);
+	if (node != NO_NODE)
+	{
+		nodes[node].locked = 1;
+	}
+	unlock_graph();
+
+	return ret;
+}
+
+int
+pthread_cond_destroy (pthread_cond_t *cond)
+{
+	int i;
+
+	init_hooks();
+
+	lock_graph();
+	for (i = 0; i < MAX_CONDS; i++)
+	{
+		if (conds[i].cond == cond)
+		{
+			conds[i].cond = NULL;
+			conds[i].mutex = NULL;
+			break;
+		}
+	}
+	unlock_graph();
+
+	return real_cond_destroy(cond);
+}
+
+static void *
+start_thread (void *data)
+{
+	struct start_args args = *(struct start_args *) data;
+	void *ret;
+
+	free(data);
+	ret = args.routine(args.arg);
+	check_held_locks();
+
+	return ret;
+}
+
+int
+pthread_create (pthread_t *thread, const pthread_attr_t *attr,
+		void *(* routine) (void *), void *arg)
+{
+	struct start_args *args;
+	int ret;
+
+	init_hooks();
+
+	args = malloc(sizeof (struct start_args));
+	if (args == NULL)
+	{
+		return real_create(thread, attr, routine, arg);
+	}
+
+	args->routine = routine;
+	args->arg = arg;
+
+	ret = real_create(thread, attr, start_thread, args);
+	if (ret != 0)
+	{
+		free(args);
+	}
+
+	return ret;
+}
+
+void
+pthread_exit (void *retval)
+{
+	init_hooks();
+	check_held_locks();
+	real_exit(retval);
+}
+
+static void __attribute__ ((constructor))
+locktrack_init (void)
+{
+	init_hooks();
+}
+
+/* The thread calling exit() (main returning) is checked here. */
+static void __attribute__ ((destructor))
+locktrack_fini (void)
+{
+	check_held_locks();
+
+	if (log_fd >= 0)
+	{
+		close(log_fd);
+		log_fd = -1;
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ * rbc_locktrack.c: Locktrack module
+ *
+ * General description:
+ *	Checks for dead locks (lock order violations), unlocking of mutexes
+ * that are not held, destruction of locked mutexes, threads exiting while
+ * holding locks and misusage of condition variables by running the tested
+ * executable with an interposition library preloaded (locktrack_preload.c)
+ * instead of under helgrind. Only lock events are observed, so the program
+ * runs at almost native speed. The problems are written to a trace log,
+ * which is resolved to source lines and reported with the same messages
+ * as the valgrind module.
+ *	Parameters:
+ *	-preload=<path>	the interposition library
+ *			(default ./modules/locktrack/liblocktrack_preload.so)
+ */
+#include <stdio.h>
+
+#include "../../include/dynamic_tool.h"
+#include "../../lib/rbc_trace.h"
+
+#define DEFAULT_PRELOAD "./modules/locktrack/liblocktrack_preload.so"
+#define TRACE_LOG "locktrack_trace"
+
+static const struct rbc_trace_kind locktrack_kinds[] =
+{
+	{"DEADLOCK", ERR_DEAD_LOCK},
+	{"UNLOCK", ERR_UNLOCK},
+	{"DESTROY", ERR_DESTROY},
+	{"COND", ERR_CONDITION_VARIABLE},
+	{"HOLD", ERR_HOLD_LOCK},
+	{NULL, ERR_NONE}
+};
+
+/*
+ * run_tool (every module contains this function)
+ *
+ * Runs the executable with the interposition library preloaded and parses
+ * the trace logs it leaves behind.
+ *
+ * returns: the list of errors detected by the tool
+ * param1: input = pointer to the information required by the
+ * tool (sources and/or executables)
+ * param2: flags = a bit set that indicates what errors are tracked
+ * at the moment of usage
+ * param3: err_count = will hold the number of errors detected
+ */
+
+struct rbc_output *
+run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count){
+	struct rbc_dynamic_input *dynamic_input = NULL;
+	struct rbc_output *output = NULL;
+	int ret;
+
+	*err_count = 0;
+	if (input == NULL || input->input_ptr == NULL || input->tool_type != DYNAMIC_TOOL)
+		return NULL;
+
+	dynamic_input = (struct rbc_dynamic_input *) input->input_ptr;
+	ret = run_preloaded(input, DEFAULT_PRELOAD, TRACE_LOG);
+	if (ret != 0){
+		if (ret == -1)
+			log_message("Locktrack interposition library not found.", stderr);
+		return NULL;
+	}
+
+	*err_count = parse_trace_logs(TRACE_LOG, locktrack_kinds, dynamic_input, flags, &output);
+
+	return output;
+}
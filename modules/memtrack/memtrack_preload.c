@@ -0,0 +1,867 @@
+/*
+ * memtrack_preload.c: interposition library used by the memtrack module
+ *
+ * General description:
+ *	Preloaded into the tested executable. Wraps the allocator
+ * (malloc/calloc/realloc/free, posix_memalign/aligned_alloc/memalign) and
+ * the descriptor API (open/creat/close, fopen/fclose) and keeps, for every
+ * live block and descriptor, the call chain that created it. When the
+ * process exits, every block that was not freed and every descriptor that
+ * was not closed is written to the trace log (see include/rbc_preload.h):
+ *	LEAK <size> <frames>
+ *	FD <fd> <frames>
+ * Like valgrind's "definitely lost", a block is reported only if no pointer
+ * to it is left in the writable segments of the loaded objects or in other
+ * reachable blocks, and blocks referenced only from other lost blocks are
+ * accounted to the block that owns them.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <link.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/auxv.h>
+#include <sys/mman.h>
+
+#include "../../include/rbc_preload.h"
+
+#define BOOTSTRAP_SIZE	8192
+#define INITIAL_SLOTS	4096
+#define MAX_FDS		1024
+
+#define EMPTY_SLOT	((void *) 0)
+#define FREED_SLOT	((void *) 1)
+
+#define UNREACHED	0
+#define REACHABLE	1
+#define INDIRECT	2
+#define LEAK_ROOT	3
+
+struct block
+{
+	void *ptr;
+	size_t size;
+	int frame_count;
+	void *frames[RBC_MAX_FRAMES + 2];
+};
+
+struct descriptor
+{
+	int used;
+	int frame_count;
+	void *frames[RBC_MAX_FRAMES + 2];
+};
+
+static void *(* real_malloc) (size_t);
+static void *(* real_calloc) (size_t, size_t);
+static void *(* real_realloc) (void *, size_t);
+static void (* real_free) (void *);
+static int (* real_posix_memalign) (void **, size_t, size_t);
+static void *(* real_aligned_alloc) (size_t, size_t);
+static void *(* real_memalign) (size_t, size_t);
+static int (* real_open) (const char *, int, ...);
+static int (* real_open64) (const char *, int, ...);
+static int (* real_creat) (const char *, mode_t);
+static int (* real_close) (int);
+static FILE *(* real_fopen) (const char *, const char *);
+static FILE *(* real_fopen64) (const char *, const char *);
+static int (* real_fclose) (FILE *);
+
+/* dlsym() may allocate before the real allocator is known */
+static char bootstrap[BOOTSTRAP_SIZE];
+static size_t bootstrap_used;
+static int initializing, initialized, finished;
+
+/* set while the library itself runs, so nested calls are not tracked */
+static RBC_TLS int in_hook;
+
+static volatile int table_lock;
+static struct block *blocks;
+static size_t slot_count, live_count, used_count;
+static struct descriptor descriptors[MAX_FDS];
+
+/* snapshot of the live blocks taken at exit, sorted by address */
+struct live_block
+{
+	uintptr_t start, end;
+	struct block *block;
+	int state;
+};
+
+static struct live_block *live;
+static size_t live_size, *mark_stack, mark_top;
+
+static void
+init_hooks (void)
+{
+	if (initialized || initializing)
+	{
+		return;
+	}
+
+	initializing = 1;
+	real_malloc = dlsym(RTLD_NEXT, "malloc");
+	real_calloc = dlsym(RTLD_NEXT, "calloc");
+	real_realloc = dlsym(RTLD_NEXT, "realloc");
+	real_free = dlsym(RTLD_NEXT, "free");
+	real_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+	real_aligned_alloc = dlsym(RTLD_NEXT, "aligned_alloc");
+	real_memalign = dlsym(RTLD_NEXT, "memalign");
+	real_open = dlsym(RTLD_NEXT, "open");
+	real_open64 = dlsym(RTLD_NEXT, "open64");
+	real_creat = dlsym(RTLD_NEXT, "creat");
+	real_close = dlsym(RTLD_NEXT, "close");
+	real_fopen = dlsym(RTLD_NEXT, "fopen");
+	real_fopen64 = dlsym(RTLD_NEXT, "fopen64");
+	real_fclose = dlsym(RTLD_NEXT, "fclose");
+	initializing = 0;
+	initialized = 1;
+}
+
+static void *
+bootstrap_alloc (size_t size)
+{
+	void *ptr;
+
+	size = (size + 15) & ~(size_t) 15;
+	if (bootstrap_used + size > sizeof (bootstrap))
+	{
+		return NULL;
+	}
+
+	ptr = bootstrap + bootstrap_used;
+	bootstrap_used += size;
+
+	return ptr;
+}
+
+static int
+is_bootstrap (void *ptr)
+{
+	return (char *) ptr >= bootstrap && (char *) ptr < bootstrap + sizeof (bootstrap);
+}
+
+static void
+lock_table (void)
+{
+	while (__sync_lock_test_and_set(&table_lock, 1))
+	{
+		while (table_lock)
+			;
+	}
+}
+
+static void
+unlock_table (void)
+{
+	__sync_lock_release(&table_lock);
+}
+
+static size_t
+hash_ptr (void *ptr, size_t slots)
+{
+	uintptr_t h = (uintptr_t) ptr >> 4;
+
+	h ^= h >> 17;
+	h *= 0x9e3779b1U;
+
+	return h & (slots - 1);
+}
+
+/* The table lives in anonymous mappings so that it never uses the allocator. */
+static int
+grow_table (void)
+{
+	struct block *old = blocks, *table;
+	size_t i, old_count = slot_count;
+	size_t new_count = slot_count ? slot_count * 2 : INITIAL_SLOTS;
+
+	/* only rehash in place when most of the used slots are tombstones */
+	if (old_count != 0 && live_count < old_count / 4)
+	{
+		new_count = old_count;
+	}
+
+	table = mmap(NULL, new_count * sizeof (struct block), PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (table == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	blocks = table;
+	slot_count = new_count;
+	used_count = 0;
+
+	for (i = 0; i < old_count; i++)
+	{
+		if (old[i].ptr != EMPTY_SLOT && old[i].ptr != FREED_SLOT)
+		{
+			size_t j = hash_ptr(old[i].ptr, slot_count);
+
+			while (blocks[j].ptr != EMPTY_SLOT)
+			{
+				j = (j + 1) & (slot_count - 1);
+			}
+
+			blocks[j] = old[i];
+			used_count++;
+		}
+	}
+
+	if (old != NULL)
+	{
+		munmap(old, old_count * sizeof (struct block));
+	}
+
+	return 0;
+}
+
+static void
+track_block (void *ptr, size_t size, void **frames, int frame_count)
+{
+	size_t i;
+
+	lock_table();
+
+	if ((used_count + 1) * 4 >= slot_count * 3 && grow_table() != 0)
+	{
+		unlock_table();
+		return;
+	}
+
+	i = hash_ptr(ptr, slot_count);
+	while (blocks[i].ptr != EMPTY_SLOT && blocks[i].ptr != FREED_SLOT)
+	{
+		i = (i + 1) & (slot_count - 1);
+	}
+
+	if (blocks[i].ptr == EMPTY_SLOT)
+	{
+		used_count++;
+	}
+
+	blocks[i].ptr = ptr;
+	blocks[i].size = size;
+	blocks[i].frame_count = frame_count;
+	memcpy(blocks[i].frames, frames, frame_count * sizeof (void *));
+	live_count++;
+
+	unlock_table();
+}
+
+static void
+untrack_block (void *ptr)
+{
+	size_t i;
+
+	lock_table();
+
+	if (slot_count != 0)
+	{
+		for (i = hash_ptr(ptr, slot_count); blocks[i].ptr != EMPTY_SLOT;
+		     i = (i + 1) & (slot_count - 1))
+		{
+			if (blocks[i].ptr == ptr)
+			{
+				blocks[i].ptr = FREED_SLOT;
+				live_count--;
+				break;
+			}
+		}
+	}
+
+	unlock_table();
+}
+
+static void
+track_fd (int fd)
+{
+	void *frames[RBC_MAX_FRAMES + 2];
+
+	if (fd < 0 || fd >= MAX_FDS)
+	{
+		return;
+	}
+
+	in_hook = 1;
+	descriptors[fd].frame_count = rbc_capture_frames(frames);
+	memcpy(descriptors[fd].frames, frames, sizeof (frames));
+	descriptors[fd].used = 1;
+	in_hook = 0;
+}
+
+static void
+untrack_fd (int fd)
+{
+	if (fd >= 0 && fd < MAX_FDS)
+	{
+		descriptors[fd].used = 0;
+	}
+}
+
+static int
+must_track (void)
+{
+	return initialized && !in_hook && !finished;
+}
+
+static void
+record_block (void *ptr, size_t size)
+{
+	void *frames[RBC_MAX_FRAMES + 2];
+	int frame_count;
+
+	in_hook = 1;
+	frame_count = rbc_capture_frames(frames);
+	track_block(ptr, size, frames, frame_count);
+	in_hook = 0;
+}
+
+void *
+malloc (size_t size)
+{
+	void *ptr;
+
+	init_hooks();
+	if (real_malloc == NULL)
+	{
+		return bootstrap_alloc(size);
+	}
+
+	ptr = real_malloc(size);
+	if (ptr != NULL && must_track())
+	{
+		record_block(ptr, size);
+	}
+
+	return ptr;
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	init_hooks();
+	if (real_calloc == NULL)
+	{
+		/* the bootstrap buffer is zero-filled */
+		return (size == 0 || nmemb <= (size_t) -1 / size) ? bootstrap_alloc(nmemb * size) : NULL;
+	}
+
+	ptr = real_calloc(nmemb, size);
+	if (ptr != NULL && must_track())
+	{
+		record_block(ptr, nmemb * size);
+	}
+
+	return ptr;
+}
+
+void *
+realloc (void *old, size_t size)
+{
+	void *ptr;
+
+	init_hooks();
+	if (is_bootstrap(old) || real_realloc == NULL)
+	{
+		ptr = malloc(size);
+		if (ptr != NULL && old != NULL)
+		{
+			size_t left = bootstrap + sizeof (bootstrap) - (char *) old;
+			memcpy(ptr, old, size < left ? size : left);
+		}
+
+		return ptr;
+	}
+
+	ptr = real_realloc(old, size);
+	if (must_track())
+	{
+		if (old != NULL && (ptr != NULL || size == 0))
+		{
+			untrack_block(old);
+		}
+
+		if (ptr != NULL)
+		{
+			record_block(ptr, size);
+		}
+	}
+
+	return ptr;
+}
+
+/* The aligned allocators are not needed while the hooks are resolved. */
+int
+posix_memalign (void **ptr, size_t alignment, size_t size)
+{
+	int ret;
+
+	init_hooks();
+	if (real_posix_memalign == NULL)
+	{
+		return ENOMEM;
+	}
+
+	ret = real_posix_memalign(ptr, alignment, size);
+	if (ret == 0 && must_track())
+	{
+		record_block(*ptr, size);
+	}
+
+	return ret;
+}
+
+void *
+aligned_alloc (size_t alignment, size_t size)
+{
+	void *ptr;
+
+	init_hooks();
+	if (real_aligned_alloc == NULL)
+	{
+		return NULL;
+	}
+
+	ptr = real_aligned_alloc(alignment, size);
+	if (ptr != NULL && must_track())
+	{
+		record_block(ptr, size);
+	}
+
+	return ptr;
+}
+
+void *
+memalign (size_t alignment, size_t size)
+{
+	void *ptr;
+
+	init_hooks();
+	if (real_memalign == NULL)
+	{
+		return NULL;
+	}
+
+	ptr = real_memalign(alignment, size);
+	if (ptr != NULL && must_track())
+	{
+		record_block(ptr, size);
+	}
+
+	return ptr;
+}
+
+void
+free (void *ptr)
+{
+	init_hooks();
+	if (ptr == NULL || is_bootstrap(ptr))
+	{
+		return;
+	}
+
+	if (must_track())
+	{
+		untrack_block(ptr);
+	}
+
+	real_free(ptr);
+}
+
+static int
+open_mode (int flags, va_list args)
+{
+#ifdef O_TMPFILE
+	if ((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE)
+#else
+	if ((flags & O_CREAT) != 0)
+#endif
+	{
+		return va_arg(args, int);
+	}
+
+	return 0;
+}
+
+int
+open (const char *path, int flags, ...)
+{
+	va_list args;
+	int fd, mode;
+
+	va_start(args, flags);
+	mode = open_mode(flags, args);
+	va_end(args);
+
+	init_hooks();
+	fd = real_open(path, flags, mode);
+	if (must_track())
+	{
+		track_fd(fd);
+	}
+
+	return fd;
+}
+
+int
+open64 (const char *path, int flags, ...)
+{
+	va_list args;
+	int fd, mode;
+
+	va_start(args, flags);
+	mode = open_mode(flags, args);
+	va_end(args);
+
+	init_hooks();
+	fd = real_open64(path, flags, mode);
+	if (must_track())
+	{
+		track_fd(fd);
+	}
+
+	return fd;
+}
+
+int
+creat (const char *path, mode_t mode)
+{
+	int fd;
+
+	init_hooks();
+	fd = real_creat(path, mode);
+	if (must_track())
+	{
+		track_fd(fd);
+	}
+
+	return fd;
+}
+
+int
+close (int fd)
+{
+	init_hooks();
+	untrack_fd(fd);
+
+	return real_close(fd);
+}
+
+FILE *
+fopen (const char *path, const char *mode)
+{
+	FILE *stream;
+
+	init_hooks();
+	stream = real_fopen(path, mode);
+	if (stream != NULL && must_track())
+	{
+		track_fd(fileno(stream));
+	}
+
+	return stream;
+}
+
+FILE *
+fopen64 (const char *path, const char *mode)
+{
+	FILE *stream;
+
+	init_hooks();
+	stream = real_fopen64(path, mode);
+	if (stream != NULL && must_track())
+	{
+		track_fd(fileno(stream));
+	}
+
+	return stream;
+}
+
+int
+fclose (FILE *stream)
+{
+	init_hooks();
+	if (stream != NULL)
+	{
+		untrack_fd(fileno(stream));
+	}
+
+	return real_fclose(stream);
+}
+
+static void __attribute__ ((constructor))
+memtrack_init (void)
+{
+	init_hooks();
+}
+
+static void *
+map_array (size_t count, size_t size)
+{
+	void *ptr = mmap(NULL, count * size + 1, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+static int
+cmp_live (const void *a, const void *b)
+{
+	const struct live_block *x = a, *y = b;
+
+	return (x->start > y->start) - (x->start < y->start);
+}
+
+static long
+find_live (uintptr_t value)
+{
+	size_t low = 0, high = live_size;
+
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+
+		if (value < live[mid].start)
+		{
+			high = mid;
+		}
+		else if (value >= live[mid].end && value != live[mid].start)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			return mid;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Marks the blocks referenced from [start, end) with 'state'. Blocks that
+ * were unreached, or are roots of other lost groups, are pushed so that
+ * their own contents are followed.
+ */
+static void
+scan_range (uintptr_t start, uintptr_t end, int state, long owner)
+{
+	uintptr_t addr;
+
+	start = (start + sizeof (void *) - 1) & ~(uintptr_t) (sizeof (void *) - 1);
+	for (addr = start; addr + sizeof (void *) <= end; addr += sizeof (void *))
+	{
+		long idx = find_live(*(uintptr_t *) addr);
+
+		if (idx < 0 || idx == owner)
+		{
+			continue;
+		}
+
+		if (live[idx].state == UNREACHED)
+		{
+			live[idx].state = state;
+			mark_stack[mark_top++] = idx;
+		}
+		else if (live[idx].state == LEAK_ROOT && state == INDIRECT)
+		{
+			/* already followed when it was a root */
+			live[idx].state = INDIRECT;
+		}
+	}
+}
+
+static void
+follow_marks (int state, long owner)
+{
+	while (mark_top > 0)
+	{
+		size_t idx = mark_stack[--mark_top];
+
+		scan_range(live[idx].start, live[idx].end, state, owner);
+	}
+}
+
+static int
+scan_segments (struct dl_phdr_info *info, size_t size, void *self_base)
+{
+	int i;
+
+	(void) size;
+	if (info->dlpi_addr == (uintptr_t) self_base)
+	{
+		/* the bookkeeping of this library is not a root */
+		return 0;
+	}
+
+	for (i = 0; i < info->dlpi_phnum; i++)
+	{
+		const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+
+		if (ph->p_type == PT_LOAD && (ph->p_flags & PF_W) != 0)
+		{
+			uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+
+			scan_range(start, start + ph->p_memsz, REACHABLE, -1);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Blocks the dynamic loader allocates itself (thread control blocks kept
+ * by the thread stack cache, dlopen bookkeeping) are referenced from
+ * memory that is not scanned; they are treated as roots.
+ */
+static int
+is_loader_block (struct block *block, void *self_base)
+{
+	uintptr_t loader = getauxval(AT_BASE);
+	Dl_info info;
+	int i;
+
+	for (i = 0; i < block->frame_count; i++)
+	{
+		if (dladdr(block->frames[i], &info) == 0 || info.dli_fbase == self_base)
+		{
+			continue;
+		}
+
+		return loader != 0 && (uintptr_t) info.dli_fbase == loader;
+	}
+
+	return 0;
+}
+
+/*
+ * Classifies the live blocks: REACHABLE from the writable segments of the
+ * loaded objects, LEAK_ROOT for lost blocks and INDIRECT for lost blocks
+ * only referenced from other lost blocks.
+ *
+ * returns: 0 on success / -1 if the snapshot could not be built, in which
+ * case every live block is reported.
+ */
+static int
+classify_blocks (void)
+{
+	Dl_info self;
+	size_t i, n = 0;
+
+	live = map_array(live_count, sizeof (struct live_block));
+	mark_stack = map_array(live_count, sizeof (size_t));
+	if (live == NULL || mark_stack == NULL)
+	{
+		return -1;
+	}
+
+	for (i = 0; i < slot_count; i++)
+	{
+		if (blocks[i].ptr != EMPTY_SLOT && blocks[i].ptr != FREED_SLOT && n < live_count)
+		{
+			live[n].start = (uintptr_t) blocks[i].ptr;
+			live[n].end = live[n].start + blocks[i].size;
+			live[n].block = &blocks[i];
+			live[n].state = UNREACHED;
+			n++;
+		}
+	}
+
+	live_size = n;
+	qsort(live, live_size, sizeof (struct live_block), cmp_live);
+
+	if (dladdr((void *) classify_blocks, &self) == 0)
+	{
+		self.dli_fbase = NULL;
+	}
+
+	dl_iterate_phdr(scan_segments, self.dli_fbase);
+	for (i = 0; i < live_size; i++)
+	{
+		if (live[i].state == UNREACHED && is_loader_block(live[i].block, self.dli_fbase))
+		{
+			live[i].state = REACHABLE;
+			mark_stack[mark_top++] = i;
+		}
+	}
+	follow_marks(REACHABLE, -1);
+
+	for (i = 0; i < live_size; i++)
+	{
+		if (live[i].state != UNREACHED)
+		{
+			continue;
+		}
+
+		live[i].state = LEAK_ROOT;
+		mark_stack[mark_top++] = i;
+		follow_marks(INDIRECT, i);
+	}
+
+	return 0;
+}
+
+/*
+ * Runs after the destructors of the executable, once the program had its
+ * last chance to release its resources.
+ */
+static void __attribute__ ((destructor))
+memtrack_report (void)
+{
+	char detail[32];
+	size_t i;
+	int fd, log_fd;
+
+	in_hook = 1;
+	finished = 1;
+
+	log_fd = rbc_open_trace_log();
+	if (log_fd < 0)
+	{
+		return;
+	}
+
+	lock_table();
+	if (classify_blocks() == 0)
+	{
+		for (i = 0; i < live_size; i++)
+		{
+			if (live[i].state == LEAK_ROOT)
+			{
+				snprintf(detail, sizeof (detail), "%lu", (unsigned long) live[i].block->size);
+				rbc_write_record(log_fd, "LEAK", detail, live[i].block->frames,
+						 live[i].block->frame_count);
+			}
+		}
+	}
+	else
+	{
+		for (i = 0; i < slot_count; i++)
+		{
+			if (blocks[i].ptr != EMPTY_SLOT && blocks[i].ptr != FREED_SLOT)
+			{
+				snprintf(detail, sizeof (detail), "%lu", (unsigned long) blocks[i].size);
+				rbc_write_record(log_fd, "LEAK", detail, blocks[i].frames, blocks[i].frame_count);
+			}
+		}
+	}
+	unlock_table();
+
+	for (fd = 0; fd < MAX_FDS; fd++)
+	{
+		if (descriptors[fd].used && fd != log_fd)
+		{
+			snprintf(detail, sizeof (detail), "%d", fd);
+			rbc_write_record(log_fd, "FD", detail, descriptors[fd].frames,
+					 descriptors[fd].frame_count);
+		}
+	}
+
+	real_close(log_fd);
+}
@@ -0,0 +1,421 @@
+/*
+ * rbc_sanitizer.c: Sanitizer module
+ *
+ * General description:
+ *	Checks for invalid memory accesses and frees, memory leaks, usage
+ * of uninitialized values and data races with compiler instrumentation
+ * instead of binary instrumentation. The sources of the tested program
+ * are rebuilt with the sanitizers and the resulting executables are run
+ * with the same arguments as the tested executable:
+ *	- AddressSanitizer + UndefinedBehaviorSanitizer: invalid accesses,
+ * invalid frees and memory leaks
+ *	- ThreadSanitizer: data races (only if ERR_DATA_RACE is tracked and
+ * the tested executable uses threads)
+ *	- MemorySanitizer: uninitialized values (only if ERR_UNINITIALIZED
+ * is tracked and the compiler is clang)
+ * The sanitizers write their reports to log files (log_path), which are
+ * parsed into the same messages as the valgrind module.
+ *	Parameters:
+ *	-cc=<compiler>		(default gcc)
+ *	-cflags=<flags>		(default -g -O0 -fno-omit-frame-pointer)
+ *	-ldflags=<flags>	(default -lpthread -lm)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glob.h>
+#include <unistd.h>
+
+#include "../../include/dynamic_tool.h"
+#include "../../lib/rbc_elf.h"
+
+#define LINE_MAX_LEN 4096
+#define CMD_MAX 8192
+#define SPACE " "
+#define DEV_NULL " > /dev/null 2>&1"
+#define CC_PARAM "-cc="
+#define CFLAGS_PARAM "-cflags="
+#define LDFLAGS_PARAM "-ldflags="
+#define DEFAULT_CC "gcc"
+#define DEFAULT_CFLAGS "-g -O0 -fno-omit-frame-pointer"
+#define DEFAULT_LDFLAGS "-lpthread -lm"
+#define SUMMARY "SUMMARY:"
+#define RUNTIME_OPTIONS ":print_stacktrace=1:halt_on_error=0"
+
+struct sanitizer_build
+{
+	const char *name;
+	const char *flags;
+	const char *options_env;
+};
+
+static const struct sanitizer_build asan_build =
+{
+	"address",
+	"-fsanitize=address,undefined -fsanitize-recover=address,undefined",
+	"ASAN_OPTIONS=log_path=%s.asan" RUNTIME_OPTIONS ":detect_leaks=1 "
+	"UBSAN_OPTIONS=log_path=%s.ubsan" RUNTIME_OPTIONS
+};
+
+static const struct sanitizer_build tsan_build =
+{
+	"thread",
+	"-fsanitize=thread",
+	"TSAN_OPTIONS=log_path=%s" RUNTIME_OPTIONS
+};
+
+static const struct sanitizer_build msan_build =
+{
+	"memory",
+	"-fsanitize=memory -fsanitize-memory-track-origins",
+	"MSAN_OPTIONS=log_path=%s" RUNTIME_OPTIONS
+};
+
+/* The first line of a report and the error it describes. */
+struct sanitizer_report
+{
+	const char *pattern;
+	enum EN_err_type err_type;
+};
+
+static const struct sanitizer_report reports[] =
+{
+	{"Direct leak of", ERR_MEMORY_LEAK},
+	{"attempting double-free", ERR_INVALID_FREE},
+	{"attempting free on address which was not malloc()-ed", ERR_INVALID_FREE},
+	{"heap-use-after-free", ERR_INVALID_ACCESS},
+	{"heap-buffer-overflow", ERR_INVALID_ACCESS},
+	{"stack-buffer-overflow", ERR_INVALID_ACCESS},
+	{"stack-buffer-underflow", ERR_INVALID_ACCESS},
+	{"global-buffer-overflow", ERR_INVALID_ACCESS},
+	{"stack-use-after-return", ERR_INVALID_ACCESS},
+	{"stack-use-after-scope", ERR_INVALID_ACCESS},
+	{"SEGV on unknown address", ERR_INVALID_ACCESS},
+	{"runtime error: index", ERR_INVALID_ACCESS},
+	{"with insufficient space for an object", ERR_INVALID_ACCESS},
+	{"runtime error: load of null pointer", ERR_INVALID_ACCESS},
+	{"runtime error: store to null pointer", ERR_INVALID_ACCESS},
+	{"runtime error: member access within null pointer", ERR_INVALID_ACCESS},
+	{"use-of-uninitialized-value", ERR_UNINITIALIZED},
+	{"ThreadSanitizer: data race", ERR_DATA_RACE},
+	{NULL, ERR_NONE}
+};
+
+/*
+ * get_param
+ *
+ * Looks for a parameter given as <prefix><value>.
+ *
+ * returns: the value of the parameter or the default value
+ * param1: input = the tool input (parameters)
+ * param2: prefix = the name of the parameter, including '='
+ * param3: default_value = returned if the parameter is missing
+ */
+
+static const char *
+get_param (struct rbc_input *input, const char *prefix, const char *default_value){
+	int i;
+	const char *value = default_value;
+
+	for (i = 0; i < input->args_count; i++){
+		if (input->tool_args[i] != NULL
+			&& strncmp(input->tool_args[i], prefix, strlen(prefix)) == 0)
+			value = input->tool_args[i] + strlen(prefix);
+	}
+
+	return value;
+}
+
+/*
+ * is_source
+ *
+ * Searches for a source name in a list of sources.
+ *
+ * returns: 1 - found /0 - not found
+ * param1: sources = the list of source names
+ * param2: source_count = the number of sources in the list
+ * param3: source = the string that is searched in the list
+ */
+
+static int
+is_source (const char **sources, int source_count, const char *source){
+	int i;
+	const char *s;
+
+	if (sources != NULL) {
+		for (i = 0; i < source_count; i++){
+			s = strrchr(sources[i], '/');
+			s = (s != NULL) ? s + 1 : sources[i];
+			if (strcmp(source, s) == 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * parse_frame
+ *
+ * Parses a stack frame of a sanitizer report, in either of the forms
+ *	#0 0x4005d4 in main /path/file.c:12:5
+ *	#0 main /path/file.c:12 (exec+0x4005d4)
+ *
+ * returns: 1 - the frame points in a source file /0 - otherwise
+ * param1: line = the line read from the report (modified)
+ * param2: f_name = will be filled with the function name
+ * param3: s_name = will be filled with the source name (no directories)
+ * param4: l_number = will be filled with the line number
+ */
+
+static int
+parse_frame (char *line, char **f_name, char **s_name, char **l_number){
+	char *p, *location, *colon;
+
+	p = strtok(line, " \t\r\n");
+	if (p == NULL || p[0] != '#')
+		return 0;
+
+	p = strtok(NULL, " \t\r\n");
+	if (p != NULL && strncmp(p, "0x", 2) == 0)
+		p = strtok(NULL, " \t\r\n");
+	if (p != NULL && strcmp(p, "in") == 0)
+		p = strtok(NULL, " \t\r\n");
+	if (p == NULL)
+		return 0;
+
+	*f_name = p;
+	location = strtok(NULL, " \t\r\n");
+	if (location == NULL || location[0] == '(')
+		return 0;
+
+	/* file:line or file:line:column */
+	colon = strrchr(location, ':');
+	if (colon == NULL)
+		return 0;
+	*colon = '\0';
+	p = strrchr(location, ':');
+	if (p != NULL && strspn(p + 1, "0123456789") == strlen(p + 1)){
+		*p = '\0';
+		*l_number = p + 1;
+	}
+	else
+		*l_number = colon + 1;
+
+	p = strrchr(location, '/');
+	*s_name = (p != NULL) ? p + 1 : location;
+
+	return strlen(*l_number) > 0;
+}
+
+/*
+ * get_info
+ *
+ * Reads the stack trace that follows the first line of a report and
+ * adds an error for its innermost frame that belongs to the sources.
+ *
+ * returns: (nothing)
+ * param1: g = the log file, positioned after the first line of a report
+ * param2: dynamic_input = the sources of the tested program
+ * param3: output = pointer to the list of errors
+ * param4: err_type = the error described by the report
+ */
+
+static void
+get_info (FILE *g, struct rbc_dynamic_input *dynamic_input, struct rbc_output **output,
+	  enum EN_err_type err_type){
+	char line[LINE_MAX_LEN], error_message[LINE_MAX_LEN];
+	char *f_name, *s_name, *l_number, *p;
+	struct rbc_output *q;
+	struct rbc_output node;
+	int in_stack = 0;
+
+	while (fgets(line, LINE_MAX_LEN, g) != NULL){
+		p = line + strspn(line, " \t");
+		if (p[0] != '#'){
+			/* the first stack trace of the report has ended */
+			if (in_stack)
+				return;
+			continue;
+		}
+
+		in_stack = 1;
+		if (!parse_frame(p, &f_name, &s_name, &l_number)
+			|| !is_source(dynamic_input->sources, dynamic_input->source_count, s_name))
+			continue;
+
+		snprintf(error_message, LINE_MAX_LEN, "In function %s, in file %s, at line %s",
+			 f_name, s_name, l_number);
+
+		for (q = *output; q != NULL; q = q->next){
+			if (q->err_type == err_type && strcmp(q->err_msg, error_message) == 0)
+				return;
+		}
+
+		node.err_type = err_type;
+		node.err_msg = strdup(error_message);
+		add(output, node);
+		return;
+	}
+}
+
+/*
+ * parse_logs
+ *
+ * Parses the reports written by a sanitized run and removes the logs.
+ *
+ * returns: (nothing)
+ * param1: log_base = the log_path given to the sanitizer runtime
+ * param2: dynamic_input = the sources of the tested program
+ * param3: flags = a bit set that indicates what errors are tracked
+ * param4: output = pointer to the list of errors
+ */
+
+static void
+parse_logs (const char *log_base, struct rbc_dynamic_input *dynamic_input, rbc_errset_t flags,
+	    struct rbc_output **output){
+	char pattern[LINE_MAX_LEN], line[LINE_MAX_LEN];
+	glob_t logs;
+	size_t i;
+	int j;
+	FILE *g;
+
+	snprintf(pattern, LINE_MAX_LEN, "%s.*", log_base);
+	if (glob(pattern, 0, NULL, &logs) != 0)
+		return;
+
+	for (i = 0; i < logs.gl_pathc; i++){
+		g = fopen(logs.gl_pathv[i], "rt");
+		if (g == NULL)
+			continue;
+
+		while (fgets(line, LINE_MAX_LEN, g) != NULL){
+			/* repeats the first line of the report it closes */
+			if (strncmp(line, SUMMARY, strlen(SUMMARY)) == 0)
+				continue;
+
+			for (j = 0; reports[j].pattern != NULL; j++){
+				if (strstr(line, reports[j].pattern) != NULL)
+					break;
+			}
+
+			if (reports[j].pattern != NULL && ISSET_ERR(reports[j].err_type, flags))
+				get_info(g, dynamic_input, output, reports[j].err_type);
+		}
+
+		fclose(g);
+		unlink(logs.gl_pathv[i]);
+	}
+
+	globfree(&logs);
+}
+
+/*
+ * run_build
+ *
+ * Builds the sources with a sanitizer, runs the result with the arguments
+ * of the tested executable and parses the reports.
+ *
+ * returns: (nothing)
+ * param1: build = the sanitizer to use
+ * param2: input = the tool input (parameters)
+ * param3: dynamic_input = the sources and arguments of the tested program
+ * param4: flags = a bit set that indicates what errors are tracked
+ * param5: output = pointer to the list of errors
+ */
+
+static void
+run_build (const struct sanitizer_build *build, struct rbc_input *input,
+	   struct rbc_dynamic_input *dynamic_input, rbc_errset_t flags, struct rbc_output **output){
+	char command[CMD_MAX], exec_name[LINE_MAX_LEN], log_base[LINE_MAX_LEN];
+	char options[LINE_MAX_LEN], buff[LINE_MAX_LEN];
+	int i;
+
+	snprintf(exec_name, LINE_MAX_LEN, "./rbc_sanitizer_%s", build->name);
+	snprintf(log_base, LINE_MAX_LEN, "rbc_sanitizer_%s_log", build->name);
+
+	snprintf(command, CMD_MAX, "%s %s %s", get_param(input, CC_PARAM, DEFAULT_CC),
+		 get_param(input, CFLAGS_PARAM, DEFAULT_CFLAGS), build->flags);
+	for (i = 0; i < dynamic_input->source_count; i++){
+		strncat(command, SPACE, CMD_MAX - strlen(command) - 1);
+		strncat(command, dynamic_input->sources[i], CMD_MAX - strlen(command) - 1);
+	}
+	snprintf(buff, LINE_MAX_LEN, " -o %s %s%s", exec_name,
+		 get_param(input, LDFLAGS_PARAM, DEFAULT_LDFLAGS), DEV_NULL);
+	strncat(command, buff, CMD_MAX - strlen(command) - 1);
+
+	if (system(command) != 0){
+		snprintf(buff, LINE_MAX_LEN, "Failed building the sources with the %s sanitizer.", build->name);
+		log_message(buff, stderr);
+		return;
+	}
+
+	/*
+	 * ASan and UBSan share a runtime that reopens its log when the second
+	 * option string is parsed, so each gets its own log under log_base
+	 */
+	snprintf(options, LINE_MAX_LEN, build->options_env, log_base, log_base);
+	snprintf(command, CMD_MAX, "%s %s", options, exec_name);
+	for (i = 0; i < dynamic_input->params_count; i++){
+		strncat(command, SPACE, CMD_MAX - strlen(command) - 1);
+		strncat(command, dynamic_input->params[i], CMD_MAX - strlen(command) - 1);
+	}
+	strncat(command, DEV_NULL, CMD_MAX - strlen(command) - 1);
+	system(command);
+
+	parse_logs(log_base, dynamic_input, flags, output);
+	unlink(exec_name + 2);
+}
+
+/*
+ * run_tool (every module contains this function)
+ *
+ * Runs a tool over the sources/executables and parses its output
+ * in order to extract all the errors reported by the tool.
+ *
+ * returns: the list of errors detected by the tool
+ * param1: input = pointer to the information required by the
+ * tool (sources and/or executables)
+ * param2: flags = a bit set that indicates what errors are tracked
+ * at the moment of usage
+ * param3: err_count = will hold the number of errors detected
+ */
+
+struct rbc_output *
+run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count){
+	struct rbc_dynamic_input *dynamic_input = NULL;
+	struct rbc_output *output = NULL;
+	const char *cc;
+
+	*err_count = 0;
+	if (input == NULL || input->input_ptr == NULL || input->tool_type != DYNAMIC_TOOL)
+		return NULL;
+
+	dynamic_input = (struct rbc_dynamic_input *) input->input_ptr;
+	if (dynamic_input->sources == NULL || dynamic_input->source_count == 0){
+		log_message("No sources to build with the sanitizers.", stderr);
+		return NULL;
+	}
+
+	if (ISSET_ERR(ERR_INVALID_ACCESS, flags) || ISSET_ERR(ERR_INVALID_FREE, flags)
+		|| ISSET_ERR(ERR_MEMORY_LEAK, flags))
+		run_build(&asan_build, input, dynamic_input, flags, &output);
+
+	if (ISSET_ERR(ERR_DATA_RACE, flags)
+		&& (inspect_executable(dynamic_input->exec_name) & RBC_CAP_THREADS) != 0)
+		run_build(&tsan_build, input, dynamic_input, flags, &output);
+
+	/* MemorySanitizer is only available in clang */
+	cc = get_param(input, CC_PARAM, DEFAULT_CC);
+	if (ISSET_ERR(ERR_UNINITIALIZED, flags)){
+		if (strstr(cc, "clang") != NULL)
+			run_build(&msan_build, input, dynamic_input, flags, &output);
+		else
+			log_message("Sanitizer: uninitialized values are not checked, "
+				    "MemorySanitizer needs -cc=clang.", stderr);
+	}
+
+	*err_count = (output != NULL) ? output->size : 0;
+
+	return output;
+}
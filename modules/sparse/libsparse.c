@@ -4,193 +4,169 @@
 #include <string.h>
 
 #include "../../include/static_tool.h"
+#include "../../sparse-0.4.1/rbc_sparse_utils/static_analyzer.h"
 
 #define SPARSE_PATH	"static_analyzer"
 
-static void
-make_command(char *command, struct rbc_input *input, struct rbc_static_input *static_input);
+struct sparse_result
+{
+	rbc_errset_t flags;
+	struct rbc_output *output;
+};
+
+static char **
+make_args(struct rbc_input *input, struct rbc_static_input *static_input, char **params, int *argc);
 
-static struct rbc_output *
-parse_output_file (FILE *f_in, rbc_errset_t flags, int file_count);
+static enum EN_err_type
+get_err_type(enum sa_check check);
 
+static void
+add_finding(void *data, enum sa_check check, const char *file,
+	    const char *function, int line, const char *message);
+
+/*
+ * The static analyzer is linked in and runs in the robocheck process:
+ * its findings come through add_finding(), one at a time.
+ */
 struct rbc_output *
 run_tool(struct rbc_input *input, rbc_errset_t flags, int *err_count)
 {
-	int i = 0;
-	char command[2 * MAX_BUFF_SIZE];
-	FILE *f_in = NULL;
+	int argc = 0;
+	char **argv = NULL, *params = NULL;
 	struct rbc_static_input *static_input = NULL;
-	struct rbc_output *output = NULL;
+	struct sparse_result result;
+
+	*err_count = 0;
+	result.flags = flags;
+	result.output = NULL;
 
 	if (input != NULL && input->tool_type == STATIC_TOOL && input->input_ptr != NULL)
 	{
 		static_input = (struct rbc_static_input *)input->input_ptr;
-		if (static_input == NULL) { return NULL; }
 
 		log_message("Hello from sparse", NULL);
 
-		make_command(command, input, static_input);
-
-		system (command);
-
-		f_in = fopen("__sparse_output", "r");
-		if (f_in == NULL)
+		argv = make_args(input, static_input, &params, &argc);
+		if (argv == NULL)
 		{
-			perror("fopen");
+			log_message("Sparse: insufficient memory.", NULL);
 			goto exit;
 		}
 
-		output = parse_output_file(f_in, flags, static_input->file_count);
+		if (run_static_analyzer(argc, argv, add_finding, &result) != 0)
+		{
+			log_message("Sparse: the static analyzer failed.", NULL);
+		}
 
-		system ("rm -rf __sparse_output");
+		free(params);
+		free(argv);
 	}
 
 exit:
-	return output;
+	if (result.output != NULL)
+	{
+		*err_count = result.output->size;
+	}
+
+	return result.output;
 }
 
-static void
-make_command(char *command, struct rbc_input *input, struct rbc_static_input *static_input)
+/*
+ * Builds the command line of the analyzer. A parameter may hold an option
+ * and its value ("-l 150"), so the parameters are split on white space,
+ * as the shell did when the analyzer was a separate program.
+ */
+static char **
+make_args(struct rbc_input *input, struct rbc_static_input *static_input, char **params, int *argc)
 {
-	int i = 0;
+	int i = 0, size = 1;
+	char **argv = NULL, *word = NULL, *save = NULL;
 
-	sprintf(command, "%s", SPARSE_PATH); 
 	for (i = 0; i < input->args_count; i++)
 	{
-		strcat (command, " ");
-		strcat (command, input->tool_args[i]);
+		size += strlen(input->tool_args[i]) + 1;
+	}
+
+	/* no more words than characters */
+	*params = (char *)malloc(size);
+	argv = (char **)malloc((size + static_input->file_count + 1) * sizeof (char *));
+	if (*params == NULL || argv == NULL)
+	{
+		free(*params);
+		free(argv);
+		*params = NULL;
+		return NULL;
+	}
+
+	(*params)[0] = '\0';
+	for (i = 0; i < input->args_count; i++)
+	{
+		strcat(*params, input->tool_args[i]);
+		strcat(*params, " ");
+	}
+
+	*argc = 0;
+	argv[(*argc)++] = (char *)SPARSE_PATH;
+	for (word = strtok_r(*params, " \t", &save); word != NULL; word = strtok_r(NULL, " \t", &save))
+	{
+		argv[(*argc)++] = word;
 	}
 
 	for (i = 0; i < static_input->file_count; i++)
 	{
-		strcat (command, " ");
-		strcat (command, static_input->file_names[i]);
+		argv[(*argc)++] = (char *)static_input->file_names[i];
 	}
+	argv[*argc] = NULL;
 
-	strcat (command, " > __sparse_output");
+	return argv;
 }
 
-static struct rbc_output *
-parse_output_file (FILE *f_in, rbc_errset_t flags, int file_count)
+static enum EN_err_type
+get_err_type(enum sa_check check)
 {
-	int i;
-	char buff[2 * MAX_BUFF_SIZE], file_name[2 * MAX_BUFF_SIZE], func_name[2 * MAX_BUFF_SIZE], *tmp = NULL, error_msg[4 * MAX_BUFF_SIZE];
-	struct rbc_output *output = NULL, output_node;
-
-	if (ISSET_ERR(ERR_UNVERIFIED_FUNCTION, flags))
+	switch (check)
 	{
-		while (fgets(buff, 2 * MAX_BUFF_SIZE, f_in))
-		{
-			if (strstr(buff, "\t\tCall Errors")) { break; }
-		}
+	case SA_FUN_CALL:
+		return ERR_UNVERIFIED_FUNCTION;
+	case SA_FUN_LINES:
+		return ERR_FUNCTION_LINE;
+	case SA_FUN_INDENT_LEVEL:
+		return ERR_FUNCTION_INDENTATION;
+	case SA_TABS_SPACES:
+		return ERR_MIXED_TABS;
+	case SA_TRAILING_WS:
+		return ERR_TRAILING_WHITESPACE;
+	default:
+		return ERR_MAX;
+	}
+}
 
-		for (i = 0; i < file_count; i++)
-		{
-			/* get line with file name */
-			fgets(buff, 2 * MAX_BUFF_SIZE, f_in);
-			sscanf(buff, "####From file: %s####", file_name);
-			tmp = strchr(file_name, '#'); if (tmp) { *tmp = 0; }
-
-			/* parse all functions until the 'end file' is found */
-			while (fgets(buff, 2 * MAX_BUFF_SIZE, f_in))
-			{
-				if (strstr(buff, "#End parsing file#")) { break; }
-
-				/* got the begining of a new function */
-				sscanf(buff, "\t#####parsing function: %s#####", func_name);
-				tmp = strchr(func_name, '#'); if (tmp) { *tmp = 0; }
-
-				/* parse function summary until 'end function' is found */
-				while (fgets(buff, 2 * MAX_BUFF_SIZE, f_in))
-				{
-					if (strstr(buff, "#end parsing function#")) { break; }
-
-					sprintf (error_msg, "From file: %s at function: %s error: %s", file_name, func_name, buff);
-					output_node.err_msg = strdup(error_msg);
-					output_node.err_type = ERR_UNVERIFIED_FUNCTION;
-
-					add(&output, output_node);
-				}
-			}
-		}
+static void
+add_finding(void *data, enum sa_check check, const char *file,
+	    const char *function, int line, const char *message)
+{
+	char error_msg[4 * MAX_BUFF_SIZE];
+	struct sparse_result *result = (struct sparse_result *)data;
+	struct rbc_output output_node;
+
+	output_node.err_type = get_err_type(check);
+	if (output_node.err_type == ERR_MAX || !ISSET_ERR(output_node.err_type, result->flags))
+	{
+		return;
 	}
 
-	if (ISSET_ERR(ERR_FUNCTION_LINE, flags) ||
-	    ISSET_ERR(ERR_FUNCTION_INDENTATION, flags) ||
-	    ISSET_ERR(ERR_TRAILING_WHITESPACE, flags) ||
-	    ISSET_ERR(ERR_MIXED_TABS, flags))
+	/* the messages of the checks of a whole function carry no line */
+	if (check == SA_FUN_LINES || check == SA_FUN_INDENT_LEVEL)
 	{
-		while (fgets(buff, 2 * MAX_BUFF_SIZE, f_in))
-		{
-			if (strstr(buff, "Other errors")) { break; }
-		}
-		
-		for (i = 0; i < file_count; i++)
-		{
-			/* get line with file name */
-			fgets(buff, 2 * MAX_BUFF_SIZE, f_in);
-			sscanf(buff, "####From file: %s####", file_name);
-			tmp = strchr(file_name, '#'); if (tmp) { *tmp = 0; }
-	
-			/* parse all functions until the 'end file' is found */
-			while (fgets(buff, 2 * MAX_BUFF_SIZE, f_in))
-			{
-				if (strstr(buff, "#End parsing file#")) { break; }
-
-				/* got the begining of a new function */
-				sscanf(buff, "\t#####parsing function: %s#####", func_name);
-				tmp = strchr(func_name, '#'); if (tmp) { *tmp = 0; }
-
-				/* parse function summary until 'end function' is found */
-				while (fgets(buff, 2 * MAX_BUFF_SIZE, f_in))
-				{
-					if (strstr(buff, "#end parsing function#")) { break; }
-
-					if (ISSET_ERR(ERR_FUNCTION_LINE, flags) && 
-					    strstr(buff, "Function line count:"))
-					{
-						sprintf (error_msg, "From file: %s at function: %s error: %s", file_name, func_name, buff);
-						output_node.err_msg = strdup(error_msg);
-						output_node.err_type = ERR_FUNCTION_LINE;
-
-						add(&output, output_node);
-					}
-
-					if (ISSET_ERR(ERR_FUNCTION_INDENTATION, flags) && 
-					    strstr(buff, "Indent level:"))
-					{
-						sprintf (error_msg, "From file: %s at function: %s error: %s", file_name, func_name, buff);
-						output_node.err_msg = strdup(error_msg);
-						output_node.err_type = ERR_FUNCTION_INDENTATION;
-
-						add(&output, output_node);
-					}
-
-					if (ISSET_ERR(ERR_MIXED_TABS, flags) &&
-					    strstr(buff, "Mixed tabs with spaces"))
-					{
-						sprintf (error_msg, "From file: %s at function: %s error: %s", file_name, func_name, buff);
-						output_node.err_msg = strdup(error_msg);
-						output_node.err_type = ERR_MIXED_TABS;
-
-						add(&output, output_node);						
-					}
-
-					if (ISSET_ERR(ERR_TRAILING_WHITESPACE, flags) &&
-					    strstr(buff, "Trailing white space"))
-					{
-						sprintf (error_msg, "From file: %s at function: %s error: %s.", file_name, func_name, buff);
-						output_node.err_msg = strdup(error_msg);
-						output_node.err_type = ERR_TRAILING_WHITESPACE;
-
-						add(&output, output_node);						
-					}
-				}
-			}
-		}
+		snprintf(error_msg, sizeof (error_msg), "From file: %s at function: %s error: %s at line %d",
+			 file, function, message, line);
+	}
+	else
+	{
+		snprintf(error_msg, sizeof (error_msg), "From file: %s at function: %s error: %s%s",
+			 file, function, message, (check == SA_TRAILING_WS) ? "." : "");
 	}
+	output_node.err_msg = strdup(error_msg);
 
-	return output;
+	add(&result->output, output_node);
 }
-
-
@@ -19,6 +19,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+	#ifndef popen
+		#define popen _popen
+		#define pclose _pclose
+	#endif
+#else
+	#include <unistd.h>
+#endif
+
 #include "../../include/static_tool.h"
 
 #define LINE_MAX 512
@@ -30,19 +39,14 @@
 #else
 	#define DEFAULT_CMD "splint"
 #endif
-#define OUTPUT " > output"
+#define OUTPUT " > "
 #define SPACE " "
-#define OUTPUT_FILE "output"
-
-#ifdef _WIN32
-	#define RM_OUTPUT "del output"
-#else
-	#define RM_OUTPUT "rm output"
-#endif
+#define OUTPUT_FILE "output.%d"
+#define JOBS_ARG "-j"
+#define MAX_JOBS 64
 
 
 extern FILE *FileLogger;
-static char *function=NULL;
 
 /*
  * get_function
@@ -51,10 +55,11 @@ static char *function=NULL;
  *
  * returns: (nothing)
  * param1: line = the parsed line (containing the function name)
+ * param2: function = the current function of the parsed output
  */
 
 static void 
-get_function(char *line){
+get_function(char *line, char **function){
 	int i=0;
 	char *p = strtok(line, SEPARATORS);
 	if (p == NULL) 
@@ -64,9 +69,9 @@ get_function(char *line){
 		if (p == NULL) 
 			return;
 	}
-	if (function != NULL)
-		free(function);
-	function = strdup(p);
+	if (*function != NULL)
+		free(*function);
+	*function = strdup(p);
 }
 
 /*
@@ -119,12 +124,13 @@ print_list(struct rbc_output *list){
  * param2: case_static = need to distinguish beetween
  * the case of a global variable (declared in the module, used
  * only inside of it but not declared static) and other parsing cases.
- * param3: output = pointer to the list of errors. 
- * param4: err_type = specifies the type of error analyzed
+ * param3: function = the current function of the parsed output
+ * param4: output = pointer to the list of errors. 
+ * param5: err_type = specifies the type of error analyzed
  */
 
 static void 
-get_info(char *line,int case_static,struct rbc_output **output,enum EN_err_type err_type){
+get_info(char *line,int case_static,const char *function,struct rbc_output **output,enum EN_err_type err_type){
 	char error_message[LINE_MAX];
 	char *s_name,*l_number;
 	struct rbc_output node;
@@ -208,12 +214,166 @@ is_signed_unsigned (char *line)
 	return (strcmp(right,left) != 0 && count_unsigned == 1);
 }
 
+/*
+ * get_jobs
+ *
+ * Finds the number of concurrent splint processes, given as "-j N"
+ * (0 - one per processor) among the arguments of the module. The
+ * argument belongs to the module and is not passed to splint.
+ *
+ * returns: the number of processes (1 when not given)
+ * param1: input = the arguments of the module
+ */
+static int
+get_jobs (struct rbc_input *input)
+{
+	int i, jobs = 1;
+
+	for (i = 0; i < input->args_count; i++) {
+		if (strncmp(input->tool_args[i], JOBS_ARG, strlen(JOBS_ARG)) != 0)
+			continue;
+
+		jobs = atoi(input->tool_args[i] + strlen(JOBS_ARG));
+#ifndef _WIN32
+		if (jobs <= 0)
+			jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	}
+
+	return (jobs < 1) ? 1 : (jobs > MAX_JOBS) ? MAX_JOBS : jobs;
+}
+
+/*
+ * start_shard
+ *
+ * Starts splint over count files, beginning with first, writing its
+ * report to the output file of the shard.
+ *
+ * returns: the started process /NULL - it could not be started
+ * param1: input = the arguments of the module
+ * param2: static_input = the sources
+ * param3: first, count = the files of the shard
+ * param4: output_file = the report of the shard
+ */
+static FILE *
+start_shard (struct rbc_input *input, struct rbc_static_input *static_input,
+	     int first, int count, const char *output_file)
+{
+	char *command = NULL;
+	size_t size = strlen(DEFAULT_CMD) + strlen(OUTPUT) + strlen(output_file) + 1;
+	FILE *proc = NULL;
+	int i;
+
+	for (i = 0; i < input->args_count; i++)
+		size += strlen(SPACE) + strlen(input->tool_args[i]);
+	for (i = first; i < first + count; i++)
+		size += strlen(SPACE) + strlen(static_input->file_names[i]);
+
+	command = malloc(size);
+	if (command == NULL)
+		return NULL;
+
+	strcpy(command, DEFAULT_CMD);
+	for (i = 0; i < input->args_count; i++) {
+		if (strncmp(input->tool_args[i], JOBS_ARG, strlen(JOBS_ARG)) == 0)
+			continue;
+		strcat(command, SPACE);
+		strcat(command, input->tool_args[i]);
+	}
+
+	for (i = first; i < first + count; i++) {
+		strcat(command, SPACE);
+		strcat(command, static_input->file_names[i]);
+	}
+
+	strcat(command, OUTPUT);
+	strcat(command, output_file);
+
+	/* the report goes to the file: the pipe only tells when it ends */
+	proc = popen(command, "r");
+	free(command);
+
+	return proc;
+}
+
+/*
+ * parse_output
+ *
+ * Extracts the tracked errors from the report of a splint process. The
+ * current function is local to the report, so that every shard is
+ * parsed on its own.
+ *
+ * returns: (nothing)
+ * param1: f = the report
+ * param2: flags = the tracked errors
+ * param3: output = pointer to the list of errors
+ */
+static void
+parse_output (FILE *f, rbc_errset_t flags, struct rbc_output **output)
+{
+	char line[LINE_MAX], scd_line[LINE_MAX];
+	char assignments[2*LINE_MAX];
+	char *function = NULL;
+
+	while (fgets(line, LINE_MAX, f) != NULL) {
+		if (strstr(line, "(in function")) {
+			get_function(line, &function);
+			continue;
+		}
+		if (ISSET_ERR(ERR_STATIC_VARIABLE, flags) &&
+				(strstr(line,"Variable exported but not used") ||
+				 strstr(line,"Function exported but not used"))) {
+			get_info(line, 1, function, output, ERR_STATIC_VARIABLE);
+			continue;
+		}
+		if (ISSET_ERR(ERR_MEMORY_LEAK, flags) &&
+				strstr(line,"Fresh storage") &&
+				strstr(line,"created")) {
+			get_info(line, 0, function, output, ERR_MEMORY_LEAK);
+			continue;
+		}
+		if (ISSET_ERR(ERR_UNINITIALIZED, flags) &&
+				strstr(line,"used before definition")) {
+			get_info(line, 0, function, output, ERR_UNINITIALIZED);
+			continue;
+		}
+		if (ISSET_ERR(ERR_INVALID_ACCESS, flags) &&
+				(strstr(line,"Likely out-of-bounds") ||
+				 strstr(line,"Possible out-of-bounds"))) {
+			get_info(line, 0, function, output, ERR_INVALID_ACCESS);
+			continue;
+		}
+		if (ISSET_ERR(ERR_SIGNED_UNSIGNED, flags) &&
+				(strstr(line,"Assignment of") ||
+				 	(strstr(line,"initialized to type") &&
+					 strstr(line,"expects")))) {
+			strcpy(assignments, line);
+			if (!strstr(line, "Assignment of") &&
+					fgets(scd_line, LINE_MAX, f) != NULL)
+				strcat(assignments, scd_line);
+			if (is_signed_unsigned(assignments)) {
+				get_info(line, 0, function, output, ERR_SIGNED_UNSIGNED);
+			}
+			continue;
+		}
+	}
+
+	free(function);
+}
+
 /*
  * run_tool (every module contains this function)
  *
  * Runs a tool over the sources/executables and parses its output
  * in order to extract all the errors reported by the tool.
  *
+ * With "-j N" among the arguments the files are split in N shards of
+ * consecutive files, each checked by its own splint process; the
+ * reports are parsed in the order of the shards, so the errors come in
+ * file order, as from a single process. A global is exported but not
+ * used only with respect to all the files, so while that error is
+ * tracked a single process checks them.
+ *
  * returns: the list of errors detected by the tool
  * param1: input = pointer to the information required by the 
  * tool (sources and/or executables)
@@ -225,86 +385,55 @@ is_signed_unsigned (char *line)
 struct rbc_output *
 run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count)
 {
-	char line[LINE_MAX], scd_line[LINE_MAX];
-	char assignments[2*LINE_MAX];
-	char command[LINE_MAX]=DEFAULT_CMD;
+	char output_file[LINE_MAX];
+	FILE *procs[MAX_JOBS];
 
 	struct rbc_static_input *static_input = NULL;
 	struct rbc_output *output = NULL;
-	struct rbc_output node;
 
 	FILE *f;
-	int i;
+	int i, jobs, first;
 
 	*err_count = 0;
-	node.err_msg = NULL;
 
 	if (input != NULL && input->input_ptr != NULL &&
 			input->tool_type == STATIC_TOOL) {
 		static_input = (struct rbc_static_input *) input->input_ptr;
-		for (i = 0; i < input->args_count; i++) {
-			strcat(command,SPACE);
-			strcat(command,input->tool_args[i]);
-		}
 
-		for (i = 0; i < static_input->file_count; i++) {
-			strcat(command,SPACE);
-			strcat(command,static_input->file_names[i]);
+		jobs = get_jobs(input);
+		if (jobs > 1 && ISSET_ERR(ERR_STATIC_VARIABLE, flags)) {
+			log_message("Splint: exported globals need all the files, running a single process.", NULL);
+			jobs = 1;
 		}
-			
-		strcat(command,OUTPUT);
-		system(command);
-
-		f = fopen(OUTPUT_FILE, "rt");
-		if (f == NULL) {
-			return NULL;
+		if (jobs > static_input->file_count)
+			jobs = (static_input->file_count > 0) ? static_input->file_count : 1;
+
+		/* shard i gets the files [i * count / jobs, (i + 1) * count / jobs) */
+		for (i = 0; i < jobs; i++) {
+			first = i * static_input->file_count / jobs;
+			sprintf(output_file, OUTPUT_FILE, i);
+			procs[i] = start_shard(input, static_input, first,
+					(i + 1) * static_input->file_count / jobs - first,
+					output_file);
 		}
 
-		while (fgets(line, LINE_MAX, f) != NULL) {
-			if (strstr(line, "(in function")) {
-				get_function(line);
-				continue;
-			}
-			if (ISSET_ERR(ERR_STATIC_VARIABLE, flags) &&
-					(strstr(line,"Variable exported but not used") ||
-					 strstr(line,"Function exported but not used"))) {
-				get_info(line, 1, &output, ERR_STATIC_VARIABLE);
-				continue;
-			}
-			if (ISSET_ERR(ERR_MEMORY_LEAK, flags) &&
-					strstr(line,"Fresh storage") &&
-					strstr(line,"created")) {
-				get_info(line, 0, &output, ERR_MEMORY_LEAK);
+		for (i = 0; i < jobs; i++) {
+			if (procs[i] == NULL) {
+				log_message("Splint: could not start the process.", NULL);
 				continue;
 			}
-			if (ISSET_ERR(ERR_UNINITIALIZED, flags) &&
-					strstr(line,"used before definition")) {
-				get_info(line, 0, &output, ERR_UNINITIALIZED);
-				continue;
-			}
-			if (ISSET_ERR(ERR_INVALID_ACCESS, flags) &&
-					(strstr(line,"Likely out-of-bounds") ||
-					 strstr(line,"Possible out-of-bounds"))) {
-				get_info(line, 0, &output, ERR_INVALID_ACCESS);
-				continue;
-			}
-			if (ISSET_ERR(ERR_SIGNED_UNSIGNED, flags) &&
-					(strstr(line,"Assignment of") ||
-					 	(strstr(line,"initialized to type") &&
-						 strstr(line,"expects")))) {
-				strcpy(assignments, line);
-				if (!strstr(line, "Assignment of") &&
-						fgets(scd_line, LINE_MAX, f) != NULL)
-					strcat(assignments, scd_line);
-				if (is_signed_unsigned(assignments)) {
-					get_info(line, 0, &output, ERR_SIGNED_UNSIGNED);
-				}
+			pclose(procs[i]);
+
+			sprintf(output_file, OUTPUT_FILE, i);
+			f = fopen(output_file, "rt");
+			if (f == NULL)
 				continue;
-			}
-		}
 
-		fclose(f);
-		system(RM_OUTPUT);
+			parse_output(f, flags, &output);
+
+			fclose(f);
+			remove(output_file);
+		}
 	}
 
 	return output;
@@ -0,0 +1,475 @@
+/*
+ * rbc_style.c: Style module
+ *
+ * General description:
+ *	Checks function line counts, indentation levels, trailing white
+ * space and lines that begin with mixed tabs and spaces without going
+ * through a C front end. Every source, as loaded and split into lines
+ * by the core, is scanned once, line by line: the white space checks look
+ * at the bounds of each line and a small tokenizer that only follows
+ * comments, literals, preprocessor lines and braces finds the functions
+ * and their nesting depth. Errors are reported with the messages of the
+ * sparse module.
+ *	Parameters (the same as the sparse module):
+ *	-l <count>		report functions with at least count lines
+ *	-i <level>		report functions nested at least level deep
+ *	-s trailing		report trailing white space
+ *	-s mixed-begin		report lines that begin with tabs and spaces
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../../include/static_tool.h"
+
+#define MSG_SIZE 4096
+#define NAME_MAX_LEN 256
+#define DEFAULT_INDENT_LEVEL 5
+#define TRAILING_PARAM "trailing"
+#define MIXED_PARAM "mixed-begin"
+#define ATTRIBUTE "__attribute__"
+
+struct style_limits
+{
+	int check_lines, max_lines;
+	int check_indent, max_indent;
+	int check_trailing, check_mixed;
+};
+
+struct style_function
+{
+	char name[NAME_MAX_LEN];
+	int first_line, last_line;
+	int max_depth;
+};
+
+/*
+ * Style messages carry no "in file", so add() would never find one of
+ * them already reported; errors are appended instead of walking the list.
+ */
+struct style_errors
+{
+	struct rbc_output *head, **tail;
+	int count;
+};
+
+/*
+ * Statements that are the body of a control statement without braces
+ * are one level deeper than the control statement, as sparse counts them.
+ */
+struct style_nesting
+{
+	int parens;
+	int header;	/* the parenthesis that closes a control header */
+	int pending;	/* a control header has ended, its body follows */
+	int unbraced;	/* levels entered without braces */
+};
+
+/*
+ * get_limits
+ *
+ * Reads the parameters of the module. Checks without a parameter stay
+ * disabled, as they are for static_analyzer.
+ *
+ * returns: (nothing)
+ * param1: input = the tool input (parameters)
+ * param2: flags = a bit set that indicates what errors are tracked
+ * param3: limits = will be filled with the enabled checks
+ */
+
+static void
+get_limits (struct rbc_input *input, rbc_errset_t flags, struct style_limits *limits){
+	char value[NAME_MAX_LEN];
+	int i;
+
+	memset(limits, 0, sizeof (*limits));
+	limits->max_lines = -1;
+	limits->max_indent = DEFAULT_INDENT_LEVEL;
+
+	for (i = 0; i < input->args_count; i++){
+		if (input->tool_args[i] == NULL)
+			continue;
+
+		if (sscanf(input->tool_args[i], "-l %d", &limits->max_lines) == 1)
+			limits->check_lines = ISSET_ERR(ERR_FUNCTION_LINE, flags);
+		else if (sscanf(input->tool_args[i], "-i %d", &limits->max_indent) == 1)
+			limits->check_indent = ISSET_ERR(ERR_FUNCTION_INDENTATION, flags);
+		else if (sscanf(input->tool_args[i], "-s %255s", value) == 1){
+			if (strcmp(value, TRAILING_PARAM) == 0)
+				limits->check_trailing = ISSET_ERR(ERR_TRAILING_WHITESPACE, flags);
+			else if (strcmp(value, MIXED_PARAM) == 0)
+				limits->check_mixed = ISSET_ERR(ERR_MIXED_TABS, flags);
+		}
+	}
+}
+
+static void
+add_error (struct style_errors *errors, enum EN_err_type err_type, const char *file_name,
+	   const char *func_name, const char *error){
+	char error_msg[MSG_SIZE];
+	struct rbc_output *node;
+
+	node = (struct rbc_output *) malloc(sizeof (struct rbc_output));
+	if (node == NULL)
+		return;
+
+	snprintf(error_msg, MSG_SIZE, "From file: %s at function: %s error: %s",
+		 file_name, func_name, error);
+	node->err_type = err_type;
+	node->err_msg = strdup(error_msg);
+	node->next = NULL;
+
+	*errors->tail = node;
+	errors->tail = &node->next;
+	errors->count++;
+}
+
+/*
+ * check_line
+ *
+ * Reports tabs mixed with spaces at the beginning of a line and white
+ * space at its end.
+ *
+ * returns: (nothing)
+ * param1: start, eol = the line, without its new line
+ * param2: tabs, spaces = the white space the line begins with
+ * param3: line = the number of the line
+ * param4: file_name, func_name = where the line is
+ * param5: limits = the enabled checks
+ * param6: errors = the list of errors
+ */
+
+static void
+check_line (const char *start, const char *eol, int tabs, int spaces, int line,
+	    const char *file_name, const char *func_name, struct style_limits *limits,
+	    struct style_errors *errors){
+	char error[MSG_SIZE];
+
+	if (limits->check_mixed && tabs && spaces){
+		snprintf(error, MSG_SIZE, "Mixed tabs with spaces. SPACES: %d TABS: %d at line %d",
+			 spaces, tabs, line);
+		add_error(errors, ERR_MIXED_TABS, file_name, func_name, error);
+	}
+
+	if (limits->check_trailing){
+		if (eol > start && eol[-1] == '\r')
+			eol--;
+
+		if (eol > start && (eol[-1] == ' ' || eol[-1] == '\t')){
+			snprintf(error, MSG_SIZE, "Trailing white space: at line %d.", line);
+			add_error(errors, ERR_TRAILING_WHITESPACE, file_name, func_name, error);
+		}
+	}
+}
+
+static void
+check_function (struct style_function *func, const char *file_name,
+		struct style_limits *limits, struct style_errors *errors){
+	char error[MSG_SIZE];
+	int line_count = func->last_line - func->first_line + 1;
+
+	if (limits->check_indent && func->max_depth >= limits->max_indent){
+		snprintf(error, MSG_SIZE, "Indent level: %d at line %d", func->max_depth, func->first_line);
+		add_error(errors, ERR_FUNCTION_INDENTATION, file_name, func->name, error);
+	}
+
+	if (limits->check_lines && (limits->max_lines <= 0 || line_count >= limits->max_lines)){
+		snprintf(error, MSG_SIZE, "Function line count: %d at line %d", line_count,
+			 func->first_line);
+		add_error(errors, ERR_FUNCTION_LINE, file_name, func->name, error);
+	}
+}
+
+static int
+is_keyword (const char *token, size_t len, const char *keyword){
+	return strlen(keyword) == len && strncmp(token, keyword, len) == 0;
+}
+
+/*
+ * follow_nesting
+ *
+ * Follows the control statements of a function body, token by token.
+ *
+ * returns: (nothing)
+ * param1: n = the nesting state of the body
+ * param2: token, len = the token (literals are passed as their quote)
+ */
+
+static void
+follow_nesting (struct style_nesting *n, const char *token, size_t len){
+	if (n->pending){
+		n->pending = 0;
+		if (*token != '{')
+			n->unbraced++;
+	}
+
+	if (isalpha((unsigned char) *token) || *token == '_'){
+		if (is_keyword(token, len, "else") || is_keyword(token, len, "do"))
+			n->pending = 1;
+		else if (is_keyword(token, len, "if") || is_keyword(token, len, "for")
+			|| is_keyword(token, len, "while") || is_keyword(token, len, "switch"))
+			n->header = -1;
+		return;
+	}
+
+	switch (*token){
+	case '(':
+		n->parens++;
+		if (n->header == -1)
+			n->header = n->parens;
+		break;
+	case ')':
+		if (n->parens == n->header){
+			n->header = 0;
+			n->pending = 1;
+		}
+		n->parens--;
+		break;
+	case ';':
+		if (n->parens == 0)
+			n->unbraced = 0;
+		break;
+	case '{':
+	case '}':
+		memset(n, 0, sizeof (*n));
+		break;
+	}
+}
+
+/*
+ * skip_until
+ *
+ * Skips the part of a comment, a literal or a preprocessor line that is
+ * on the current line.
+ *
+ * returns: the first character after the skipped text
+ * param1: p = the first character of the skipped text
+ * param2: eol = the end of the line
+ * param3: stop = the character that ends the text ('\n' for line comments
+ * and preprocessor lines, '/' for block comments, the quote for literals);
+ * set to 0 when the text ends on this line
+ */
+
+static const char *
+skip_until (const char *p, const char *eol, char *stop){
+	for (; p < eol; p++){
+		if (*p == '\\' && *stop != '/'){
+			/* escaped characters and continued lines */
+			if (++p == eol)
+				return eol;
+			continue;
+		}
+
+		if (*p == *stop && (*stop != '/' || p[-1] == '*')){
+			*stop = 0;
+			return p + 1;
+		}
+	}
+
+	/* only block comments go on past the end of a line */
+	if (*stop != '/')
+		*stop = 0;
+
+	return eol;
+}
+
+/*
+ * scan_source
+ *
+ * Scans a source once, line by line, through the line table of the core.
+ * The white space a line begins and ends with is checked on the line
+ * bounds; the rest of the line goes through a pass that follows the
+ * braces to find the functions (a brace that follows a parameter list
+ * outside any block) and their nesting depth.
+ *
+ * returns: (nothing)
+ * param1: source = the source, as loaded by the core
+ * param2: file_name = the name reported for the source
+ * param3: limits = the enabled checks
+ * param4: errors = the list of errors
+ */
+
+static void
+scan_source (const struct rbc_source *source, const char *file_name,
+	     struct style_limits *limits, struct style_errors *errors){
+	char candidate[NAME_MAX_LEN] = "", ident[NAME_MAX_LEN] = "";
+	const char *p, *q, *line_start, *eol, *end = source->data + source->size;
+	int line, ident_line = 0, candidate_line = 0, tabs, spaces;
+	int depth = 0, parens = 0, in_function = 0, is_data = 0, level;
+	char prev = 0, stop = 0;
+	struct style_function func;
+	struct style_nesting nesting;
+
+	memset(&func, 0, sizeof (func));
+	memset(&nesting, 0, sizeof (nesting));
+
+	for (line = 1; line <= source->line_count; line++){
+		line_start = source->data + source->line_offsets[line - 1];
+		eol = (line < source->line_count) ? source->data + source->line_offsets[line] : end;
+		if (eol > line_start && eol[-1] == '\n')
+			eol--;
+		p = line_start;
+
+		/* the line goes on with a comment, a literal or a directive */
+		if (stop)
+			p = skip_until(p, eol, &stop);
+		else {
+			for (tabs = spaces = 0; p < eol && (*p == ' ' || *p == '\t'); p++){
+				if (*p == ' ')
+					spaces++;
+				else
+					tabs++;
+			}
+			while (p < eol && isspace((unsigned char) *p))
+				p++;
+
+			if (p < eol && *p == '#'){
+				stop = '\n';
+				p = skip_until(p + 1, eol, &stop);
+			}
+			/* comment lines are left to the comment style */
+			else if (p < eol && in_function
+				 && !(*p == '/' && p + 1 < eol && (p[1] == '*' || p[1] == '/'))){
+				check_line(line_start, eol, tabs, spaces, line, file_name, func.name,
+					   limits, errors);
+				level = depth + nesting.unbraced + (nesting.pending && *p != '{');
+				if (*p != '{' && *p != '}' && level > func.max_depth)
+					func.max_depth = level;
+			}
+		}
+
+		while (p < eol){
+			if (isspace((unsigned char) *p)){
+				p++;
+				continue;
+			}
+
+			if (*p == '/' && p + 1 < eol && (p[1] == '/' || p[1] == '*')){
+				stop = (p[1] == '/') ? '\n' : '/';
+				p = skip_until(p + 2, eol, &stop);
+				continue;
+			}
+
+			/* a function ends at its last statement, as for sparse */
+			if (in_function && *p != '}')
+				func.last_line = line;
+
+			if (*p == '"' || *p == '\''){
+				if (in_function)
+					follow_nesting(&nesting, p, 1);
+				stop = *p;
+				p = skip_until(p + 1, eol, &stop);
+				prev = '"';
+				continue;
+			}
+
+			if (isalpha((unsigned char) *p) || *p == '_'){
+				for (q = p; q < eol && (isalnum((unsigned char) *q) || *q == '_'); q++)
+					;
+				if (depth == 0 && q - p < NAME_MAX_LEN){
+					memcpy(ident, p, q - p);
+					ident[q - p] = '\0';
+					ident_line = line;
+				}
+				if (in_function)
+					follow_nesting(&nesting, p, q - p);
+				p = q;
+				prev = 'a';
+				continue;
+			}
+
+			if (depth == 0){
+				switch (*p){
+				case '(':
+					if (parens++ == 0 && candidate[0] == '\0' && ident[0] != '\0'
+						&& strcmp(ident, ATTRIBUTE) != 0){
+						strcpy(candidate, ident);
+						candidate_line = ident_line;
+					}
+					break;
+				case ')':
+					parens--;
+					break;
+				case '=':
+					is_data = 1;
+					break;
+				case ';':
+					candidate[0] = ident[0] = '\0';
+					is_data = parens = 0;
+					break;
+				case '{':
+					if (prev == ')' && candidate[0] != '\0' && !is_data){
+						in_function = 1;
+						strcpy(func.name, candidate);
+						func.first_line = func.last_line = candidate_line;
+						func.max_depth = 0;
+						memset(&nesting, 0, sizeof (nesting));
+					}
+					break;
+				}
+			}
+			else if (in_function)
+				follow_nesting(&nesting, p, 1);
+
+			if (*p == '{')
+				depth++;
+			else if (*p == '}' && depth > 0 && --depth == 0){
+				if (in_function)
+					check_function(&func, file_name, limits, errors);
+				in_function = is_data = parens = 0;
+				candidate[0] = ident[0] = '\0';
+			}
+
+			prev = *p++;
+		}
+	}
+}
+
+/*
+ * run_tool (every module contains this function)
+ *
+ * Checks the style of every source.
+ *
+ * returns: the list of errors detected by the tool
+ * param1: input = pointer to the information required by the
+ * tool (sources and/or executables)
+ * param2: flags = a bit set that indicates what errors are tracked
+ * at the moment of usage
+ * param3: err_count = will hold the number of errors detected
+ */
+
+struct rbc_output *
+run_tool (struct rbc_input *input, rbc_errset_t flags, int *err_count){
+	char buff[MSG_SIZE];
+	struct rbc_static_input *static_input = NULL;
+	struct style_errors errors = {NULL, NULL, 0};
+	struct style_limits limits;
+	struct rbc_source *source;
+	int i;
+
+	*err_count = 0;
+	if (input == NULL || input->input_ptr == NULL || input->tool_type != STATIC_TOOL)
+		return NULL;
+
+	static_input = (struct rbc_static_input *) input->input_ptr;
+	get_limits(input, flags, &limits);
+	errors.tail = &errors.head;
+
+	for (i = 0; i < static_input->file_count; i++){
+		source = (static_input->sources != NULL) ? &static_input->sources[i] : NULL;
+		if (source == NULL || source->data == NULL){
+			snprintf(buff, MSG_SIZE, "Style: could not read %s.", static_input->file_names[i]);
+			log_message(buff, stderr);
+			continue;
+		}
+
+		scan_source(source, static_input->file_names[i], &limits, &errors);
+	}
+
+	if (errors.head != NULL)
+		errors.head->size = errors.count;
+	*err_count = errors.count;
+
+	return errors.head;
+}
@@ -0,0 +1,977 @@
+/*
+ * similarity.c: robo_similarity, cross-submission similarity index
+ *
+ * Every submission added to an index is reduced to the winnowed
+ * fingerprints of its normalized token k-grams (identifiers and literals
+ * compare equal, so renaming does not hide a copy). The index is an
+ * append-only file of (fingerprint, submission) postings plus a list of
+ * submissions, so a late submission only costs its own fingerprints:
+ *
+ *	robo_similarity --add <index> <submission> <file> [file ...]
+ *		adds a submission and prints the indexed ones that share
+ *		at least 50 percent of their fingerprints with it
+ *	robo_similarity --report <index> [threshold]
+ *		prints every pair of submissions that share at least
+ *		threshold percent (default 50) of their fingerprints
+ *
+ * Pairs are found by grouping the postings by fingerprint, so the work
+ * grows with the number of fingerprints, not with the number of pairs of
+ * submissions. Fingerprints shared by more than half of the submissions
+ * are taken for template code and ignored, by both.
+ *
+ * An --add holds an exclusive lock on <index>.lock and replaces the index
+ * and its list of submissions by renaming complete copies over them, so
+ * that concurrent runs neither lose a submission nor see half of one.
+ */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+	#include <sys/file.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "../lib/rbc_lexer.h"
+#include "../lib/rbc_constants.h"
+
+#define INDEX_MAGIC		"RBCSIM01"
+#define SUBS_SUFFIX		".subs"
+#define LOCK_SUFFIX		".lock"
+#define TEMP_SUFFIX		".tmp"
+#define KGRAM_SIZE		12
+#define WINDOW_SIZE		8
+#define DEFAULT_THRESHOLD	50
+#define FNV_OFFSET		14695981039346656037ULL
+#define FNV_PRIME		1099511628211ULL
+#define KGRAM_BASE		1000003ULL
+
+typedef unsigned long long fingerprint_t;
+
+struct sim_posting
+{
+	fingerprint_t fingerprint;
+	unsigned int submission;
+};
+
+struct sim_submission
+{
+	char *name;
+	int count;		// number of distinct fingerprints
+};
+
+struct sim_index
+{
+	char *path;
+	struct sim_submission *subs;
+	int sub_count, sub_size;
+};
+
+struct sim_fingerprints
+{
+	fingerprint_t *values;
+	int count, size;
+};
+
+/* Number of fingerprints two submissions share, keyed by the pair. */
+struct sim_pair
+{
+	unsigned long long key;
+	int shared;
+};
+
+struct sim_pairs
+{
+	struct sim_pair *pairs;
+	int count, size;
+};
+
+static void
+usage (const char *);
+
+static int
+lock_index (const char *, int );
+
+static int
+open_index (const char *, struct sim_index *);
+
+static void
+close_index (struct sim_index *);
+
+static int
+fingerprint_files (char **, int , struct sim_fingerprints *);
+
+static int
+add_submission (struct sim_index *, const char *, char **, int );
+
+static int
+report_pairs (struct sim_index *, int );
+
+static void
+usage (const char *name)
+{
+	fprintf(stderr, "Usage: %s --add <index> <submission> <file> [file ...]\n", name);
+	fprintf(stderr, "       %s --report <index> [threshold]\n", name);
+}
+
+static char *
+suffixed_path (const char *path, const char *suffix)
+{
+	char *name = (char *) malloc(strlen(path) + strlen(suffix) + 1);
+
+	if (name != NULL)
+	{
+		sprintf(name, "%s%s", path, suffix);
+	}
+
+	return name;
+}
+
+/*
+ * lock_index
+ *
+ * Locks <path>.lock, which is never replaced, unlike the index: the lock
+ * is released when the process exits.
+ *
+ * returns: 0 - success /-1 - failure
+ * param1: path = the index
+ * param2: exclusive = 1 - to add a submission / 0 - to read the index
+ */
+static int
+lock_index (const char *path, int exclusive)
+{
+#ifndef _WIN32
+	char *lock = suffixed_path(path, LOCK_SUFFIX);
+	int fd = (lock != NULL) ? open(lock, O_RDWR | O_CREAT, 0644) : -1;
+
+	if (fd < 0 || flock(fd, exclusive ? LOCK_EX : LOCK_SH) != 0)
+	{
+		perror((lock != NULL) ? lock : path);
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		free(lock);
+		return -1;
+	}
+	free(lock);
+#else
+	(void) path;
+	(void) exclusive;
+#endif
+
+	return 0;
+}
+
+/* more than half of the submissions share the fingerprint: template code */
+static int
+is_template (int holders, int sub_count)
+{
+	return holders > ((sub_count / 2 > 2) ? sub_count / 2 : 2);
+}
+
+/*
+ * open_index
+ *
+ * Reads the submissions of an index. A missing index is created empty.
+ *
+ * returns: 0 - success /-1 - the index is not a similarity index
+ * param1: path = the index
+ * param2: index = will be filled with the submissions
+ */
+static int
+open_index (const char *path, struct sim_index *index)
+{
+	char magic[sizeof (INDEX_MAGIC)], line[4 * MAX_BUFF_SIZE], *subs = NULL;
+	unsigned int params[2];
+	struct sim_submission *temp = NULL;
+	int id, count, offset;
+	FILE *f = NULL;
+
+	memset(index, 0, sizeof (*index));
+	index->path = strdup(path);
+
+	f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		/* a new index: the header records how fingerprints are made */
+		f = fopen(path, "wb");
+		params[0] = KGRAM_SIZE;
+		params[1] = WINDOW_SIZE;
+		if (f == NULL || fwrite(INDEX_MAGIC, 1, strlen(INDEX_MAGIC), f) != strlen(INDEX_MAGIC) ||
+		    fwrite(params, sizeof (params[0]), 2, f) != 2)
+		{
+			perror(path);
+			if (f != NULL)
+			{
+				fclose(f);
+			}
+			return -1;
+		}
+		fclose(f);
+		return 0;
+	}
+
+	if (fread(magic, 1, strlen(INDEX_MAGIC), f) != strlen(INDEX_MAGIC) ||
+	    strncmp(magic, INDEX_MAGIC, strlen(INDEX_MAGIC)) != 0 ||
+	    fread(params, sizeof (params[0]), 2, f) != 2 ||
+	    params[0] != KGRAM_SIZE || params[1] != WINDOW_SIZE)
+	{
+		fprintf(stderr, "%s: not an index of this version of robo_similarity.\n", path);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	subs = suffixed_path(path, SUBS_SUFFIX);
+	f = (subs != NULL) ? fopen(subs, "rt") : NULL;
+	free(subs);
+	if (f == NULL)
+	{
+		return 0;
+	}
+
+	/* every line is: <id> <fingerprint count> <name> */
+	while (fgets(line, sizeof (line), f) != NULL)
+	{
+		if (sscanf(line, "%d %d %n", &id, &count, &offset) != 2 || id != index->sub_count)
+		{
+			continue;
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+
+		if (index->sub_count == index->sub_size)
+		{
+			index->sub_size = index->sub_size ? 2 * index->sub_size : ALLOC_INC;
+			temp = (struct sim_submission *) realloc(index->subs, index->sub_size * sizeof (struct sim_submission));
+			if (temp == NULL)
+			{
+				break;
+			}
+			index->subs = temp;
+		}
+
+		index->subs[index->sub_count].name = strdup(line + offset);
+		index->subs[index->sub_count].count = count;
+		index->sub_count++;
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+static void
+close_index (struct sim_index *index)
+{
+	int i;
+
+	for (i = 0; i < index->sub_count; i++)
+	{
+		free(index->subs[i].name);
+	}
+
+	free(index->subs);
+	free(index->path);
+}
+
+static fingerprint_t
+hash_token (const struct rbc_token *token)
+{
+	fingerprint_t hash = FNV_OFFSET;
+	const char *text = token->text;
+	int i, len = token->len;
+
+	switch (token->type)
+	{
+		case TOK_IDENTIFIER:
+			text = "$id";
+			break;
+		case TOK_NUMBER:
+			text = "$num";
+			break;
+		case TOK_STRING:
+			text = "$str";
+			break;
+		case TOK_CHARACTER:
+			text = "$chr";
+			break;
+		default:
+			break;
+	}
+
+	if (text != token->text)
+	{
+		len = strlen(text);
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		hash ^= (unsigned char) text[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static int
+add_fingerprint (struct sim_fingerprints *fps, fingerprint_t value)
+{
+	fingerprint_t *temp = NULL;
+
+	if (fps->count == fps->size)
+	{
+		fps->size = fps->size ? 2 * fps->size : ALLOC_INC;
+		temp = (fingerprint_t *) realloc(fps->values, fps->size * sizeof (fingerprint_t));
+		if (temp == NULL)
+		{
+			return -1;
+		}
+		fps->values = temp;
+	}
+
+	fps->values[fps->count++] = value;
+
+	return 0;
+}
+
+/*
+ * winnow
+ *
+ * Hashes every k-gram of a token stream and keeps, from each window of
+ * WINDOW_SIZE consecutive k-grams, the smallest hash (the rightmost one
+ * on ties). Any match of KGRAM_SIZE + WINDOW_SIZE - 1 tokens is then
+ * guaranteed to share a fingerprint.
+ *
+ * returns: 0 - success /-1 - out of memory
+ * param1: hashes, count = the token hashes
+ * param2: fps = the fingerprints the selected hashes are appended to
+ */
+static int
+winnow (const fingerprint_t *hashes, int count, struct sim_fingerprints *fps)
+{
+	fingerprint_t power = 1, kgram = 0, *kgrams = NULL;
+	int i, j, min = -1, kgram_count = count - KGRAM_SIZE + 1, windows, width, status = 0;
+
+	if (kgram_count <= 0)
+	{
+		return 0;
+	}
+
+	kgrams = (fingerprint_t *) malloc(kgram_count * sizeof (fingerprint_t));
+	if (kgrams == NULL)
+	{
+		return -1;
+	}
+
+	for (i = 1; i < KGRAM_SIZE; i++)
+	{
+		power *= KGRAM_BASE;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (i >= KGRAM_SIZE)
+		{
+			kgram -= hashes[i - KGRAM_SIZE] * power;
+		}
+		kgram = kgram * KGRAM_BASE + hashes[i];
+
+		if (i >= KGRAM_SIZE - 1)
+		{
+			kgrams[i - KGRAM_SIZE + 1] = kgram;
+		}
+	}
+
+	/* a stream shorter than a window is a single window */
+	windows = (kgram_count > WINDOW_SIZE) ? kgram_count - WINDOW_SIZE + 1 : 1;
+	width = (kgram_count > WINDOW_SIZE) ? WINDOW_SIZE : kgram_count;
+
+	for (i = 0; i < windows && status == 0; i++)
+	{
+		/* the minimum is searched again only when it leaves the window */
+		if (min < i)
+		{
+			for (min = i, j = i; j < i + width; j++)
+			{
+				if (kgrams[j] <= kgrams[min])
+				{
+					min = j;
+				}
+			}
+			status = add_fingerprint(fps, kgrams[min]);
+		}
+		else if (kgrams[i + width - 1] <= kgrams[min])
+		{
+			min = i + width - 1;
+			status = add_fingerprint(fps, kgrams[min]);
+		}
+	}
+
+	free(kgrams);
+
+	return status;
+}
+
+static int
+cmp_fingerprints (const void *a, const void *b)
+{
+	fingerprint_t f1 = *(const fingerprint_t *) a, f2 = *(const fingerprint_t *) b;
+
+	return (f1 > f2) - (f1 < f2);
+}
+
+static char *
+read_file (const char *file_name, long *size)
+{
+	char *buff = NULL;
+	FILE *f = fopen(file_name, "rb");
+
+	if (f == NULL)
+	{
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	buff = (char *) malloc(*size + 1);
+	if (buff != NULL && (long) fread(buff, 1, *size, f) != *size)
+	{
+		free(buff);
+		buff = NULL;
+	}
+
+	fclose(f);
+
+	return buff;
+}
+
+/*
+ * fingerprint_files
+ *
+ * Computes the distinct fingerprints of the sources of a submission.
+ * Preprocessor lines are left out, the same headers are included by all.
+ *
+ * returns: 0 - success /-1 - a source could not be read
+ * param1: files, file_count = the sources
+ * param2: fps = will be filled with the sorted, distinct fingerprints
+ */
+static int
+fingerprint_files (char **files, int file_count, struct sim_fingerprints *fps)
+{
+	struct rbc_token_list tokens = {NULL, 0, 0};
+	fingerprint_t *hashes = NULL;
+	char *buff = NULL;
+	long size;
+	int i, j, count, distinct, status = 0;
+
+	memset(fps, 0, sizeof (*fps));
+
+	for (i = 0; i < file_count && status == 0; i++)
+	{
+		buff = read_file(files[i], &size);
+		if (buff == NULL)
+		{
+			perror(files[i]);
+			status = -1;
+			break;
+		}
+
+		tokens.count = 0;
+		if (tokenize_source(buff, buff + size, &tokens) < 0)
+		{
+			status = -1;
+		}
+
+		hashes = (fingerprint_t *) malloc((tokens.count + 1) * sizeof (fingerprint_t));
+		if (hashes == NULL)
+		{
+			status = -1;
+		}
+
+		for (j = 0, count = 0; status == 0 && j < tokens.count; j++)
+		{
+			if (tokens.tokens[j].type != TOK_DIRECTIVE)
+			{
+				hashes[count++] = hash_token(&tokens.tokens[j]);
+			}
+		}
+
+		if (status == 0)
+		{
+			status = winnow(hashes, count, fps);
+		}
+
+		free(hashes);
+		free(buff);
+	}
+
+	free_token_list(&tokens);
+
+	if (fps->count > 0)
+	{
+		qsort(fps->values, fps->count, sizeof (fingerprint_t), cmp_fingerprints);
+		for (i = 1, distinct = 1; i < fps->count; i++)
+		{
+			if (fps->values[i] != fps->values[distinct - 1])
+			{
+				fps->values[distinct++] = fps->values[i];
+			}
+		}
+		fps->count = distinct;
+	}
+
+	return status;
+}
+
+/* returns: the position of value in fps /-1 - not found */
+static int
+find_fingerprint (struct sim_fingerprints *fps, fingerprint_t value)
+{
+	fingerprint_t *found = (fingerprint_t *) bsearch(&value, fps->values, fps->count,
+	                                                 sizeof (fingerprint_t), cmp_fingerprints);
+
+	return (found != NULL) ? (int) (found - fps->values) : -1;
+}
+
+static int
+read_posting (FILE *f, struct sim_posting *posting)
+{
+	return fread(&posting->fingerprint, sizeof (posting->fingerprint), 1, f) == 1 &&
+	       fread(&posting->submission, sizeof (posting->submission), 1, f) == 1;
+}
+
+static int
+write_posting (FILE *f, fingerprint_t fingerprint, unsigned int submission)
+{
+	return fwrite(&fingerprint, sizeof (fingerprint), 1, f) == 1 &&
+	       fwrite(&submission, sizeof (submission), 1, f) == 1;
+}
+
+/*
+ * replace_file
+ *
+ * Closes the complete copy of a file and renames it over the file.
+ *
+ * returns: 0 - success /-1 - failure, the copy is removed
+ * param1: f = the copy, open for writing
+ * param2: temp, path = the copy and the file it replaces
+ */
+static int
+replace_file (FILE *f, const char *temp, const char *path)
+{
+	int failed = ferror(f);
+
+	if (fclose(f) != 0 || failed || rename(temp, path) != 0)
+	{
+		perror(path);
+		remove(temp);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+similarity (int shared, int count1, int count2)
+{
+	int smaller = (count1 < count2) ? count1 : count2;
+
+	return (smaller > 0) ? (100 * shared) / smaller : 0;
+}
+
+/*
+ * add_submission
+ *
+ * Fingerprints a submission and compares it with the indexed ones while
+ * copying the postings once, then adds its own postings to the copy and
+ * its name to a copy of the list of submissions. The copies replace the
+ * index, postings first: a reader ignores the postings of a submission
+ * that is not listed yet. The caller holds the lock of the index.
+ *
+ * returns: 0 - success /-1 - failure
+ * param1: index = the index
+ * param2: name = the name of the submission
+ * param3: files, file_count = the sources of the submission
+ */
+static int
+add_submission (struct sim_index *index, const char *name, char **files, int file_count)
+{
+	struct sim_fingerprints fps;
+	struct sim_posting posting, *matches = NULL, *temp = NULL;
+	unsigned int id = index->sub_count;
+	int *shared = NULL, *holders = NULL, i, pos, score, status = 0;
+	int match_count = 0, match_size = 0;
+	char header[sizeof (INDEX_MAGIC) + 2 * sizeof (unsigned int)];
+	char *postings_temp = NULL, *subs = NULL, *subs_temp = NULL;
+	size_t header_size = strlen(INDEX_MAGIC) + 2 * sizeof (unsigned int);
+	FILE *f = NULL, *out = NULL;
+
+	for (i = 0; i < index->sub_count; i++)
+	{
+		if (strcmp(index->subs[i].name, name) == 0)
+		{
+			fprintf(stderr, "%s: submission already indexed.\n", name);
+			return -1;
+		}
+	}
+
+	if (fingerprint_files(files, file_count, &fps) != 0)
+	{
+		free(fps.values);
+		return -1;
+	}
+
+	shared = (int *) calloc(index->sub_count + 1, sizeof (int));
+	holders = (int *) calloc(fps.count + 1, sizeof (int));
+	postings_temp = suffixed_path(index->path, TEMP_SUFFIX);
+	subs = suffixed_path(index->path, SUBS_SUFFIX);
+	subs_temp = (subs != NULL) ? suffixed_path(subs, TEMP_SUFFIX) : NULL;
+	if (shared == NULL || holders == NULL || postings_temp == NULL || subs_temp == NULL)
+	{
+		perror("malloc");
+		status = -1;
+		goto exit;
+	}
+
+	f = fopen(index->path, "rb");
+	out = (f != NULL) ? fopen(postings_temp, "wb") : NULL;
+	if (out == NULL || fread(header, 1, header_size, f) != header_size ||
+	    fwrite(header, 1, header_size, out) != header_size)
+	{
+		perror(index->path);
+		status = -1;
+		goto exit;
+	}
+
+	/* which submission holds which of the fingerprints, while copying */
+	while (status == 0 && read_posting(f, &posting))
+	{
+		if (!write_posting(out, posting.fingerprint, posting.submission))
+		{
+			status = -1;
+			break;
+		}
+
+		pos = (posting.submission < id) ? find_fingerprint(&fps, posting.fingerprint) : -1;
+		if (pos < 0)
+		{
+			continue;
+		}
+
+		holders[pos]++;
+		if (match_count == match_size)
+		{
+			match_size = match_size ? 2 * match_size : ALLOC_INC;
+			temp = (struct sim_posting *) realloc(matches, match_size * sizeof (struct sim_posting));
+			if (temp == NULL)
+			{
+				status = -1;
+				break;
+			}
+			matches = temp;
+		}
+		/* the position of the fingerprint in fps stands for it */
+		matches[match_count].fingerprint = pos;
+		matches[match_count++].submission = posting.submission;
+	}
+	fclose(f);
+	f = NULL;
+
+	for (i = 0; status == 0 && i < fps.count; i++)
+	{
+		if (!write_posting(out, fps.values[i], id))
+		{
+			status = -1;
+		}
+	}
+
+	if (status != 0)
+	{
+		perror(postings_temp);
+		goto exit;
+	}
+
+	status = replace_file(out, postings_temp, index->path);
+	out = NULL;
+	if (status != 0)
+	{
+		goto exit;
+	}
+
+	out = fopen(subs_temp, "wt");
+	if (out == NULL)
+	{
+		perror(subs_temp);
+		status = -1;
+		goto exit;
+	}
+	for (i = 0; i < index->sub_count; i++)
+	{
+		fprintf(out, "%d %d %s\n", i, index->subs[i].count, index->subs[i].name);
+	}
+	fprintf(out, "%u %d %s\n", id, fps.count, name);
+	status = replace_file(out, subs_temp, subs);
+	out = NULL;
+	if (status != 0)
+	{
+		goto exit;
+	}
+
+	/* the same template code as a report of the index with the submission */
+	for (i = 0; i < match_count; i++)
+	{
+		if (!is_template(holders[matches[i].fingerprint] + 1, index->sub_count + 1))
+		{
+			shared[matches[i].submission]++;
+		}
+	}
+
+	for (i = 0; i < index->sub_count; i++)
+	{
+		score = similarity(shared[i], fps.count, index->subs[i].count);
+		if (score >= DEFAULT_THRESHOLD)
+		{
+			printf("%s %s %d%% (%d fingerprints)\n", name, index->subs[i].name, score, shared[i]);
+		}
+	}
+
+exit:
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+	if (out != NULL)
+	{
+		fclose(out);
+		remove(postings_temp);
+		remove(subs_temp);
+	}
+	free(postings_temp);
+	free(subs_temp);
+	free(subs);
+	free(matches);
+	free(holders);
+	free(shared);
+	free(fps.values);
+
+	return status;
+}
+
+static int
+cmp_postings (const void *a, const void *b)
+{
+	const struct sim_posting *p1 = (const struct sim_posting *) a;
+	const struct sim_posting *p2 = (const struct sim_posting *) b;
+
+	if (p1->fingerprint != p2->fingerprint)
+	{
+		return (p1->fingerprint > p2->fingerprint) - (p1->fingerprint < p2->fingerprint);
+	}
+
+	return (p1->submission > p2->submission) - (p1->submission < p2->submission);
+}
+
+static int
+cmp_pairs (const void *a, const void *b)
+{
+	return ((const struct sim_pair *) b)->shared - ((const struct sim_pair *) a)->shared;
+}
+
+/*
+ * count_pair
+ *
+ * Counts a fingerprint shared by two submissions. Pairs live in an open
+ * addressing table (key 0 is free: a pair is never made of one submission).
+ *
+ * returns: 0 - success /-1 - out of memory
+ * param1: pairs = the table
+ * param2: a, b = the submissions (a < b)
+ */
+static int
+count_pair (struct sim_pairs *pairs, unsigned int a, unsigned int b)
+{
+	unsigned long long key = ((unsigned long long) b << 32) | a;
+	struct sim_pair *old = pairs->pairs;
+	int i, slot, old_size = pairs->size;
+
+	if (2 * (pairs->count + 1) > pairs->size)
+	{
+		pairs->size = pairs->size ? 2 * pairs->size : 1024;
+		pairs->pairs = (struct sim_pair *) calloc(pairs->size, sizeof (struct sim_pair));
+		if (pairs->pairs == NULL)
+		{
+			pairs->pairs = old;
+			pairs->size = old_size;
+			return -1;
+		}
+
+		for (i = 0; i < old_size; i++)
+		{
+			if (old[i].key != 0)
+			{
+				slot = (int) ((old[i].key * FNV_PRIME) >> 32) & (pairs->size - 1);
+				while (pairs->pairs[slot].key != 0)
+				{
+					slot = (slot + 1) & (pairs->size - 1);
+				}
+				pairs->pairs[slot] = old[i];
+			}
+		}
+		free(old);
+	}
+
+	slot = (int) ((key * FNV_PRIME) >> 32) & (pairs->size - 1);
+	while (pairs->pairs[slot].key != 0 && pairs->pairs[slot].key != key)
+	{
+		slot = (slot + 1) & (pairs->size - 1);
+	}
+
+	if (pairs->pairs[slot].key == 0)
+	{
+		pairs->pairs[slot].key = key;
+		pairs->count++;
+	}
+	pairs->pairs[slot].shared++;
+
+	return 0;
+}
+
+/*
+ * report_pairs
+ *
+ * Prints the pairs of submissions whose similarity reaches the threshold,
+ * the most similar first.
+ *
+ * returns: 0 - success /-1 - failure
+ * param1: index = the index
+ * param2: threshold = the least similarity reported, in percents
+ */
+static int
+report_pairs (struct sim_index *index, int threshold)
+{
+	struct sim_posting *postings = NULL, *temp = NULL;
+	struct sim_pairs pairs = {NULL, 0, 0};
+	int count = 0, size = 0, i, j, k, end, status = 0;
+	unsigned int a, b;
+	FILE *f = NULL;
+
+	f = fopen(index->path, "rb");
+	if (f == NULL)
+	{
+		perror(index->path);
+		return -1;
+	}
+
+	fseek(f, strlen(INDEX_MAGIC) + 2 * sizeof (unsigned int), SEEK_SET);
+	for (;;)
+	{
+		if (count == size)
+		{
+			size = size ? 2 * size : ALLOC_INC;
+			temp = (struct sim_posting *) realloc(postings, size * sizeof (struct sim_posting));
+			if (temp == NULL)
+			{
+				status = -1;
+				break;
+			}
+			postings = temp;
+		}
+
+		if (!read_posting(f, &postings[count]))
+		{
+			break;
+		}
+		if (postings[count].submission < (unsigned int) index->sub_count)
+		{
+			count++;
+		}
+	}
+	fclose(f);
+
+	qsort(postings, count, sizeof (struct sim_posting), cmp_postings);
+
+	for (i = 0; i < count && status == 0; i = end)
+	{
+		for (end = i + 1; end < count && postings[end].fingerprint == postings[i].fingerprint; end++)
+			;
+
+		if (is_template(end - i, index->sub_count))
+		{
+			continue;
+		}
+
+		for (j = i; j < end && status == 0; j++)
+		{
+			for (k = j + 1; k < end && status == 0; k++)
+			{
+				status = count_pair(&pairs, postings[j].submission, postings[k].submission);
+			}
+		}
+	}
+
+	for (i = 0, j = 0; i < pairs.size; i++)
+	{
+		if (pairs.pairs[i].key != 0)
+		{
+			pairs.pairs[j++] = pairs.pairs[i];
+		}
+	}
+	qsort(pairs.pairs, j, sizeof (struct sim_pair), cmp_pairs);
+
+	for (i = 0; i < j; i++)
+	{
+		a = (unsigned int) (pairs.pairs[i].key & 0xffffffffU);
+		b = (unsigned int) (pairs.pairs[i].key >> 32);
+		k = similarity(pairs.pairs[i].shared, index->subs[a].count, index->subs[b].count);
+
+		if (k >= threshold)
+		{
+			printf("%s %s %d%% (%d fingerprints)\n", index->subs[a].name, index->subs[b].name,
+			       k, pairs.pairs[i].shared);
+		}
+	}
+
+	free(pairs.pairs);
+	free(postings);
+
+	return status;
+}
+
+int
+main (int argc, char **argv)
+{
+	struct sim_index index = {NULL, NULL, 0, 0};
+	int status = EXIT_FAILURE;
+
+	if (argc > 4 && strcmp(argv[1], "--add") == 0)
+	{
+		if (lock_index(argv[2], 1) == 0 && open_index(argv[2], &index) == 0 &&
+		    add_submission(&index, argv[3], argv + 4, argc - 4) == 0)
+		{
+			status = EXIT_SUCCESS;
+		}
+		close_index(&index);
+	}
+	else if (argc > 2 && strcmp(argv[1], "--report") == 0)
+	{
+		if (lock_index(argv[2], 0) == 0 && open_index(argv[2], &index) == 0 &&
+		    report_pairs(&index, (argc > 3) ? atoi(argv[3]) : DEFAULT_THRESHOLD) == 0)
+		{
+			status = EXIT_SUCCESS;
+		}
+		close_index(&index);
+	}
+	else
+	{
+		usage(argv[0]);
+	}
+
+	return status;
+}
@@ -48,6 +48,8 @@ void drop_all_allocations(struct allocator_struct *desc)
 	}
 }
 
+static struct allocator_struct *allocators;
+
 void free_one_entry(struct allocator_struct *desc, void *entry)
 {
 	void **p = entry;
@@ -87,6 +89,11 @@ void *allocate(struct allocator_struct *desc, unsigned int size)
 		struct allocation_blob *newblob = blob_alloc(chunking);
 		if (!newblob)
 			die("out of memory");
+		if (!desc->registered) {
+			desc->registered = 1;
+			desc->next = allocators;
+			allocators = desc;
+		}
 		desc->total_bytes += chunking;
 		newblob->next = blob;
 		blob = newblob;
@@ -126,4 +133,54 @@ ALLOCATOR(instruction, "instruction");
 ALLOCATOR(multijmp, "multijmp");
 ALLOCATOR(pseudo, "pseudo");
 
+/*
+ * The front end of a long-lived program keeps what it allocated at
+ * start-up (the builtins, the -include and prelude headers) and drops
+ * what every batch of translation units allocated after it, except the
+ * identifiers: they stay interned in the hash table. The statistics
+ * start from zero at both points, so that they describe one batch, the
+ * identifiers included.
+ */
+static void clear_allocation_stats(struct allocator_struct *desc)
+{
+	desc->allocations = 0;
+	desc->total_bytes = 0;
+	desc->useful_bytes = 0;
+}
+
+void protect_all_allocations(void)
+{
+	struct allocator_struct *desc;
 
+	for (desc = allocators; desc; desc = desc->next) {
+		if (desc != &ident_allocator)
+			protect_allocations(desc);
+		clear_allocation_stats(desc);
+	}
+}
+
+void clear_all_allocations(void)
+{
+	struct allocator_struct *desc;
+
+	for (desc = allocators; desc; desc = desc->next) {
+		if (desc != &ident_allocator)
+			drop_all_allocations(desc);
+		else
+			clear_allocation_stats(desc);
+	}
+}
+
+/*
+ * The statistics of show_allocations(), for every allocator used so
+ * far: one tab separated line each, after a header line.
+ */
+void report_allocations(FILE *out)
+{
+	struct allocator_struct *desc;
+
+	fprintf(out, "allocator\tallocations\tuseful_bytes\ttotal_bytes\n");
+	for (desc = allocators; desc; desc = desc->next)
+		fprintf(out, "%s\t%u\t%u\t%u\n", desc->name,
+			desc->allocations, desc->useful_bytes, desc->total_bytes);
+}
@@ -1,6 +1,8 @@
 #ifndef ALLOCATE_H
 #define ALLOCATE_H
 
+#include <stdio.h>
+
 struct allocation_blob {
 	struct allocation_blob *next;
 	unsigned int left, offset;
@@ -15,6 +17,9 @@ struct allocator_struct {
 	void *freelist;
 	/* statistics */
 	unsigned int allocations, total_bytes, useful_bytes;
+	/* every allocator that has allocated, for the *_all_allocations() */
+	struct allocator_struct *next;
+	int registered;
 };
 
 extern void protect_allocations(struct allocator_struct *desc);
@@ -22,6 +27,9 @@ extern void drop_all_allocations(struct allocator_struct *desc);
 extern void *allocate(struct allocator_struct *desc, unsigned int size);
 extern void free_one_entry(struct allocator_struct *desc, void *entry);
 extern void show_allocations(struct allocator_struct *);
+extern void protect_all_allocations(void);
+extern void clear_all_allocations(void);
+extern void report_allocations(FILE *);
 
 #define __DECLARE_ALLOCATOR(type, x)		\
 	extern type *__alloc_##x(int);		\
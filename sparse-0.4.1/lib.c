@@ -164,12 +164,20 @@ void expression_error(struct expression *expr, const char *fmt, ...)
 	expr->ctype = &bad_ctype;
 }
 
+/*
+ * Programs running sparse in-process may set this to leave a fatal
+ * error without exit(); the hook must not return.
+ */
+void (*die_hook)(void) = NULL;
+
 void error_die(struct position pos, const char * fmt, ...)
 {
 	va_list args;
 	va_start(args, fmt);
 	do_warn("error: ", pos, fmt, args);
 	va_end(args);
+	if (die_hook)
+		die_hook();
 	exit(1);
 }
 
@@ -183,6 +191,8 @@ void die(const char *fmt, ...)
 	va_end(args);
 
 	fprintf(stderr, "%s\n", buffer);
+	if (die_hook)
+		die_hook();
 	exit(1);
 }
 
@@ -219,6 +229,31 @@ int preprocess_only;
 int cmdline_include_nr = 0;
 struct cmdline_include cmdline_include[CMDLINE_INCLUDE];
 
+/*
+ * Headers included by the initial stream, in global scope, after the
+ * predefined macros: files including them later find them tokenized
+ * already, so they are preprocessed once. Their declarations are bound
+ * only while a file that includes them is parsed.
+ */
+int prelude_header_nr = 0;
+const char *prelude_header[MAX_PRELUDE_HEADERS];
+static int prelude_stream = -1;
+
+void add_prelude_header(const char *name)
+{
+	if (prelude_header_nr >= MAX_PRELUDE_HEADERS)
+		die("too many prelude headers for %s\n", name);
+	prelude_header[prelude_header_nr++] = name;
+}
+
+void show_prelude_stream(int stream)
+{
+	if (prelude_stream < 0 || stream <= prelude_stream ||
+	    stream >= input_streams[prelude_stream].nested_end)
+		return;
+	show_builtin_symbols(stream, input_streams[stream].nested_end);
+}
+
 
 void add_pre_buffer(const char *fmt, ...)
 {
@@ -289,6 +324,10 @@ static void add_cmdline_include(char *filename)
 	}
 	if (cmdline_include_nr >= CMDLINE_INCLUDE)
 		die("too many include files for %s\n", filename);
+	/* named by its stream, which outlives the command line */
+	filename = strdup(filename);
+	if (!filename)
+		die("out of memory");
 	cmdline_include[cmdline_include_nr].filename = filename;
 	cmdline_include[cmdline_include_nr].fd = fd;
 	cmdline_include_nr++;
@@ -511,6 +550,15 @@ static char **handle_dirafter(char *arg, char **next)
 	return next;
 }
 
+static char **handle_prelude(char *arg, char **next)
+{
+	char *name = *++next;
+	if (!name)
+		die("missing argument for -prelude option");
+	add_prelude_header(name);
+	return next;
+}
+
 struct switches {
 	const char *name;
 	char **(*fn)(char *, char **);
@@ -521,6 +569,7 @@ char **handle_switch(char *arg, char **next)
 	static struct switches cmd[] = {
 		{ "nostdinc", handle_nostdinc },
 		{ "dirafter", handle_dirafter },
+		{ "prelude", handle_prelude },
 		{ NULL, NULL }
 	};
 	struct switches *s;
@@ -694,6 +743,7 @@ static struct symbol_list *sparse_file(const char *filename)
  */
 static struct symbol_list *sparse_initial(void)
 {
+	struct symbol_list *list;
 	struct token *token;
 	int i;
 
@@ -706,16 +756,24 @@ static struct symbol_list *sparse_initial(void)
 
 	// Prepend the initial built-in stream
 	token = tokenize_buffer(pre_buffer, pre_buffer_size, token);
-	return sparse_tokenstream(token);
+	prelude_stream = prelude_header_nr ? input_stream_nr - 1 : -1;
+	list = sparse_tokenstream(token);
+
+	// The prelude headers are seen only by the files including them
+	hide_builtin_symbols(prelude_stream + 1, prelude_stream >= 0 ?
+			     input_streams[prelude_stream].nested_end : 0);
+	return list;
 }
 
 struct symbol_list *sparse_initialize(int argc, char **argv, struct string_list **filelist)
 {
 	char **args;
 	struct symbol_list *list;
+	int i;
 
 	// Initialize symbol stream first, so that we can add defines etc
 	init_symbols();
+	prelude_header_nr = 0;
 
 	args = argv;
 	for (;;) {
@@ -741,6 +799,8 @@ struct symbol_list *sparse_initialize(int argc, char **argv, struct string_list
 		add_pre_buffer("#define __CHECKER__ 1\n");
 		if (!preprocess_only)
 			declare_builtin_functions();
+		for (i = 0; i < prelude_header_nr; i++)
+			add_pre_buffer("#include <%s>\n", prelude_header[i]);
 
 		list = sparse_initial();
 
@@ -753,6 +813,60 @@ struct symbol_list *sparse_initialize(int argc, char **argv, struct string_list
 	return list;
 }
 
+/*
+ * Scoped allocations, for programs that parse batch after batch of files:
+ * protect_initial_state() keeps what was allocated so far, the symbols of
+ * sparse_initialize() and their types, and clear_unit_state() frees what
+ * the translation units parsed since allocated. The initial symbols must
+ * have been evaluated: a file must not leave its expressions in them.
+ */
+static int kept_stream_nr = -1;
+
+void protect_initial_state(void)
+{
+	protect_builtin_scope();
+	protect_fouled_types();
+	kept_stream_nr = input_stream_nr;
+	protect_all_allocations();
+}
+
+void clear_unit_state(void)
+{
+	if (kept_stream_nr < 0)
+		return;
+
+	translation_unit_used_list = NULL;
+	rehide_builtin_symbols();
+	clear_builtin_scope();
+	clear_fouled_types();
+	clear_streams(kept_stream_nr);
+	clear_all_allocations();
+}
+
+/*
+ * reset_front_end() undoes a sparse_initialize() that did not complete,
+ * which die() may leave half done: the next sparse_initialize() starts
+ * over from the builtins, the identifiers only are kept. The state must
+ * not have been protected.
+ */
+void reset_front_end(void)
+{
+	translation_unit_used_list = NULL;
+	clear_ident_symbols();
+	reset_builtin_scope();
+	reset_fouled_types();
+	clear_streams(0);
+	clear_all_allocations();
+	reset_include_paths();
+
+	while (cmdline_include_nr > 0)
+		free(cmdline_include[--cmdline_include_nr].filename);
+	pre_buffer_size = 0;
+	prelude_header_nr = 0;
+	prelude_stream = -1;
+	kept_stream_nr = -1;
+}
+
 struct symbol_list * sparse_keep_tokens(char *filename)
 {
 	struct symbol_list *res;
@@ -760,6 +874,7 @@ struct symbol_list * sparse_keep_tokens(char *filename)
 	/* Clear previous symbol list */
 	translation_unit_used_list = NULL;
 
+	rehide_builtin_symbols();
 	new_file_scope();
 	res = sparse_file(filename);
 
@@ -16,6 +16,7 @@
 
 #include "compat.h"
 #include "ptrlist.h"
+#include "ptrvec.h"
 
 extern int verbose, optimize, optimize_size, preprocessing;
 extern int die_if_error;
@@ -42,6 +43,13 @@ struct cmdline_include {
 extern struct cmdline_include cmdline_include[];
 extern int cmdline_include_nr;
 
+#define MAX_PRELUDE_HEADERS 20
+
+extern const char *prelude_header[];
+extern int prelude_header_nr;
+extern void add_prelude_header(const char *name);
+extern void show_prelude_stream(int stream);
+
 
 struct ident;
 struct token;
@@ -63,6 +71,9 @@ DECLARE_PTR_LIST(multijmp_list, struct multijmp);
 DECLARE_PTR_LIST(pseudo_list, struct pseudo);
 DECLARE_PTR_LIST(string_list, char);
 
+DECLARE_PTR_VEC(symbol_vec, struct symbol);
+DECLARE_PTR_VEC(statement_vec, struct statement);
+
 typedef struct pseudo *pseudo_t;
 
 struct token *skip_to(struct token *, int);
@@ -77,6 +88,7 @@ struct token *expect(struct token *, int, const char *);
 #define SENTINEL_ATTR
 #endif
 extern void die(const char *, ...) FORMAT_ATTR(1) NORETURN_ATTR;
+extern void (*die_hook)(void);
 extern void info(struct position, const char *, ...) FORMAT_ATTR(2);
 extern void warning(struct position, const char *, ...) FORMAT_ATTR(2);
 extern void sparse_error(struct position, const char *, ...) FORMAT_ATTR(2);
@@ -118,6 +130,9 @@ extern struct symbol_list *sparse_initialize(int argc, char **argv, struct strin
 extern struct symbol_list *__sparse(char *filename);
 extern struct symbol_list *sparse_keep_tokens(char *filename);
 extern struct symbol_list *sparse(char *filename);
+extern void protect_initial_state(void);
+extern void clear_unit_state(void);
+extern void reset_front_end(void);
 
 static inline int symbol_list_size(struct symbol_list *list)
 {
@@ -117,6 +117,9 @@ struct statement {
         /* robocheck adds */
         struct statement *prt_stmt;
         int indent_level;
+        int du_stamp, du_first, du_last;
+        int du_children, du_child_count;
+        struct statement_vec *stmt_vec;
 };
 
 extern struct symbol_list *function_computed_target_list;
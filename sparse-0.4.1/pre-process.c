@@ -19,6 +19,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <time.h>
+#include <errno.h>
 
 #include "pre-process.h"
 #include "lib.h"
@@ -44,6 +45,24 @@ static const char **quote_includepath = includepath;
 static const char **angle_includepath = includepath + 1;
 static const char **sys_includepath   = includepath + 1;
 
+/* Back to the paths above, before the switches of a new front end */
+void reset_include_paths(void)
+{
+	static const char *const default_includepath[] = {
+		"",
+		"/usr/include",
+		"/usr/local/include",
+		GCC_INTERNAL_INCLUDE,
+	};
+
+	memset(includepath, 0, sizeof(includepath));
+	memcpy(includepath, default_includepath, sizeof(default_includepath));
+	quote_includepath = includepath;
+	angle_includepath = includepath + 1;
+	sys_includepath = includepath + 1;
+	false_nesting = 0;
+}
+
 #define dirty_stream(stream)				\
 	do {						\
 		if (!stream->dirty) {			\
@@ -633,13 +652,15 @@ static const char *token_name_sequence(struct token *token, int endop, struct to
 static int already_tokenized(const char *path)
 {
 	int i;
-	struct stream *s = input_streams;
+	struct stream *s;
 
-	for (i = input_stream_nr; --i >= 0; s++) {
+	for (i = first_stream_named(path); i >= 0; i = s->next_named) {
+		s = input_streams + i;
 		if (s->constant != CONSTANT_FILE_YES)
 			continue;
 		if (strcmp(path, s->name))
 			continue;
+		show_prelude_stream(i);
 		if (s->protect && !lookup_macro(s->protect))
 			continue;
 		return 1;
@@ -699,6 +720,62 @@ static void set_stream_include_path(struct stream *stream)
 	includepath[0] = path;
 }
 
+/*
+ * The paths try_include() could not open. A guarded header that was
+ * found never needed this, already_tokenized() answers for it before any
+ * open(); but every #include searching the same include directories
+ * used to repeat the open() of the paths where the header is not.
+ */
+#define MISSING_HASH_SIZE (1024)
+
+struct missing_path {
+	struct missing_path *next;
+	char name[];
+};
+
+static struct missing_path *missing_paths[MISSING_HASH_SIZE];
+
+static int is_missing(const char *name)
+{
+	struct missing_path *m = missing_paths[hash_path(name) % MISSING_HASH_SIZE];
+
+	for (; m; m = m->next)
+		if (!strcmp(m->name, name))
+			return 1;
+	return 0;
+}
+
+static void add_missing(const char *name)
+{
+	unsigned long hash = hash_path(name) % MISSING_HASH_SIZE;
+	struct missing_path *m = malloc(sizeof(*m) + strlen(name) + 1);
+
+	if (!m)
+		return;
+	strcpy(m->name, name);
+	m->next = missing_paths[hash];
+	missing_paths[hash] = m;
+}
+
+/*
+ * Forgets the missing paths, for programs that keep the preprocessor
+ * across runs while the files change.
+ */
+void clear_include_cache(void)
+{
+	int i;
+
+	for (i = 0; i < MISSING_HASH_SIZE; i++) {
+		struct missing_path *m = missing_paths[i];
+		while (m) {
+			struct missing_path *next = m->next;
+			free(m);
+			m = next;
+		}
+		missing_paths[i] = NULL;
+	}
+}
+
 static int try_include(const char *path, const char *filename, int flen, struct token **where, const char **next_path)
 {
 	int fd;
@@ -713,14 +790,18 @@ static int try_include(const char *path, const char *filename, int flen, struct
 	memcpy(fullname+plen, filename, flen);
 	if (already_tokenized(fullname))
 		return 1;
+	if (is_missing(fullname))
+		return 0;
 	fd = open(fullname, O_RDONLY);
 	if (fd >= 0) {
 		char * streamname = __alloc_bytes(plen + flen);
 		memcpy(streamname, fullname, plen + flen);
-		*where = tokenize(streamname, fd, *where, next_path);
+		*where = tokenize_header(streamname, fd, *where, next_path);
 		close(fd);
 		return 1;
 	}
+	if (errno == ENOENT || errno == ENOTDIR)
+		add_missing(fullname);
 	return 0;
 }
 
@@ -1727,6 +1808,7 @@ static void do_preprocess(struct token **list)
 			}
 			if (!stream->dirty)
 				stream->constant = CONSTANT_FILE_YES;
+			stream->nested_end = input_stream_nr;
 			*list = next->next;
 			continue;
 		case TOKEN_STREAMBEGIN:
@@ -230,6 +230,39 @@ void concat_ptr_list(struct ptr_list *a, struct ptr_list **b)
 	} END_FOR_EACH_PTR(entry);
 }
 
+/*
+ * Keeps the first nr entries of the list and frees the blocks after
+ * them. Only for lists that have been appended to since they had nr
+ * entries: nothing deleted or packed.
+ */
+void __truncate_ptr_list(struct ptr_list **listp, int nr)
+{
+	struct ptr_list *head = *listp, *list = head, *next;
+
+	if (!head)
+		return;
+	if (nr <= 0) {
+		__free_ptr_list(listp);
+		return;
+	}
+
+	do {
+		if (nr <= list->nr) {
+			list->nr = nr;
+			next = list->next;
+			list->next = head;
+			head->prev = list;
+			while (next != head) {
+				struct ptr_list *tmp = next;
+				next = next->next;
+				__free_ptrlist(tmp);
+			}
+			return;
+		}
+		nr -= list->nr;
+	} while ((list = list->next) != head);
+}
+
 void __free_ptr_list(struct ptr_list **listp)
 {
 	struct ptr_list *tmp, *list = *listp;
@@ -43,6 +43,7 @@ extern void sort_list(struct ptr_list **, int (*)(const void *, const void *));
 extern void **__add_ptr_list(struct ptr_list **, void *, unsigned long);
 extern void concat_ptr_list(struct ptr_list *a, struct ptr_list **b);
 extern void __free_ptr_list(struct ptr_list **);
+extern void __truncate_ptr_list(struct ptr_list **, int);
 extern int ptr_list_size(struct ptr_list *);
 extern int linearize_ptr_list(struct ptr_list *, void **, int);
 
@@ -62,6 +63,8 @@ extern int linearize_ptr_list(struct ptr_list *, void **, int);
 	add_ptr_list_tag(list,entry,0)
 #define free_ptr_list(list) \
 	do { VRFY_PTR_LIST(*(list)); __free_ptr_list((struct ptr_list **)(list)); } while (0)
+#define truncate_ptr_list(list,nr) \
+	do { VRFY_PTR_LIST(*(list)); __truncate_ptr_list((struct ptr_list **)(list), (nr)); } while (0)
 
 #define PTR_ENTRY_NOTAG(h,i)	((h)->list[i])
 #define PTR_ENTRY(h,i)	(void *)(~3UL & (unsigned long)PTR_ENTRY_NOTAG(h,i))
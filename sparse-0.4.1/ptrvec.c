@@ -0,0 +1,64 @@
+/*
+ * ptrvec.c
+ *
+ * Contiguous pointer vectors
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib.h"
+#include "ptrvec.h"
+
+#define PTR_VEC_MIN (8)
+
+static struct ptr_vec *alloc_ptr_vec(int alloc)
+{
+	struct ptr_vec *vec = malloc(sizeof(*vec) + alloc * sizeof(void *));
+
+	if (!vec)
+		die("out of memory");
+	vec->nr = 0;
+	vec->alloc = alloc;
+	return vec;
+}
+
+struct ptr_vec *__ptr_list_to_vec(struct ptr_list *head)
+{
+	struct ptr_list *list = head;
+	struct ptr_vec *vec;
+	int i, nr = ptr_list_size(head);
+
+	if (!nr)
+		return NULL;
+
+	vec = alloc_ptr_vec(nr);
+	do {
+		for (i = 0; i < list->nr; i++)
+			vec->list[vec->nr++] = PTR_ENTRY(list, i);
+	} while ((list = list->next) != head);
+	return vec;
+}
+
+void **__add_ptr_vec(struct ptr_vec **vecp, void *ptr)
+{
+	struct ptr_vec *vec = *vecp;
+
+	if (!vec) {
+		vec = alloc_ptr_vec(PTR_VEC_MIN);
+	} else if (vec->nr == vec->alloc) {
+		struct ptr_vec *bigger = alloc_ptr_vec(vec->alloc * 2);
+		memcpy(bigger->list, vec->list, vec->nr * sizeof(void *));
+		bigger->nr = vec->nr;
+		free(vec);
+		vec = bigger;
+	}
+	*vecp = vec;
+	vec->list[vec->nr] = ptr;
+	return vec->list + vec->nr++;
+}
+
+void __free_ptr_vec(struct ptr_vec **vecp)
+{
+	free(*vecp);
+	*vecp = NULL;
+}
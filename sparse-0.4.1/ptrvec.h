@@ -0,0 +1,73 @@
+#ifndef PTR_VEC_H
+#define PTR_VEC_H
+
+/*
+ * Contiguous pointer vectors.
+ *
+ * A ptr_list is a ring of small blocks, cheap to add to and to delete
+ * from. Lists that are only read once they are built (the statements
+ * of a block, the symbols of a file) can be copied to a ptr_vec, one
+ * array of untagged entries, and walked with the same macros.
+ */
+
+#include "ptrlist.h"
+
+#define DECLARE_PTR_VEC(vecname,type)	struct vecname { int nr, alloc; type *list[]; }
+
+struct ptr_vec {
+	int nr, alloc;
+	void *list[];
+};
+
+extern struct ptr_vec *__ptr_list_to_vec(struct ptr_list *);
+extern void **__add_ptr_vec(struct ptr_vec **, void *);
+extern void __free_ptr_vec(struct ptr_vec **);
+
+#define ptr_vec_size(vec)	((vec) ? (vec)->nr : 0)
+
+/* vec = the entries of head, untagged; NULL for an empty list */
+#define ptr_list_to_vec(head,vec)							\
+	do {										\
+		(void)(&(head)->list[0] == &(vec)->list[0]);				\
+		(vec) = (__typeof__(vec)) __ptr_list_to_vec((struct ptr_list *)(head));	\
+	} while (0)
+
+#define add_ptr_vec(vec,entry) \
+	((__typeof__(&(*(vec))->list[0])) (CHECK_TYPE(*(vec),(entry)),__add_ptr_vec((struct ptr_vec **)(vec), (entry))))
+#define free_ptr_vec(vec) \
+	__free_ptr_vec((struct ptr_vec **)(vec))
+
+/*
+ * Same shape as FOR_EACH_PTR(): "break" and "continue" behave the same,
+ * so a loop can switch from one to the other.
+ */
+#define FOR_EACH_VEC(vec, ptr) do {							\
+	struct ptr_vec *__vec##ptr = (struct ptr_vec *) (vec);				\
+	CHECK_TYPE(vec,ptr);								\
+	if (__vec##ptr) {								\
+		int __nr##ptr;								\
+		for (__nr##ptr = 0; __nr##ptr < __vec##ptr->nr; __nr##ptr++) {	\
+			do {								\
+				ptr = __vec##ptr->list[__nr##ptr];			\
+				do {
+
+#define END_FOR_EACH_VEC(ptr)								\
+				} while (0);						\
+			} while (0);							\
+		}									\
+	}										\
+} while (0)
+
+#define FOR_EACH_VEC_REVERSE(vec, ptr) do {						\
+	struct ptr_vec *__vec##ptr = (struct ptr_vec *) (vec);				\
+	CHECK_TYPE(vec,ptr);								\
+	if (__vec##ptr) {								\
+		int __nr##ptr = __vec##ptr->nr;						\
+		while (--__nr##ptr >= 0) {						\
+			do {								\
+				ptr = __vec##ptr->list[__nr##ptr];			\
+				do {
+
+#define END_FOR_EACH_VEC_REVERSE(ptr) END_FOR_EACH_VEC(ptr)
+
+#endif /* PTR_VEC_H */
@@ -1,81 +1,167 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "black_list.h"
 
-static char **BlackList = NULL;
-static int BlackListCount = 0;
+#include "../token.h"
+
+/*
+ * The black list is a set of interned identifiers: the front end returns
+ * the same struct ident for every use of a name, so a lookup hashes the
+ * pointer it already has and compares pointers, never strings. The set
+ * is open addressed and kept at most half full.
+ */
+static const struct ident **BlackList = NULL;
+static unsigned int BlackListSize = 0;
+static unsigned int BlackListCount = 0;
+static char *BlackListPath = NULL;
+
+static int
+add_black_listed(const struct ident *ident);
+
+static void
+free_black_list(void);
+
+static int
+add_black_listed(const struct ident *ident)
+{
+    const struct ident **temp = NULL;
+    unsigned int i, j, size;
+
+    if ((BlackListCount + 1) * 2 > BlackListSize)
+    {
+        size = (BlackListSize != 0) ? BlackListSize * 2 : BL_SIZE_INC;
+        temp = calloc(size, sizeof (*temp));
+        if (temp == NULL)
+        {
+            return -1;
+        }
+
+        for (i = 0; i < BlackListSize; i++)
+        {
+            if (BlackList[i] == NULL)
+            {
+                continue;
+            }
+            for (j = BlackList[i]->hash & (size - 1); temp[j] != NULL; j = (j + 1) & (size - 1));
+            temp[j] = BlackList[i];
+        }
+
+        free(BlackList);
+        BlackList = temp;
+        BlackListSize = size;
+    }
+
+    for (j = ident->hash & (BlackListSize - 1); BlackList[j] != NULL; j = (j + 1) & (BlackListSize - 1))
+    {
+        if (BlackList[j] == ident)
+        {
+            return 0;
+        }
+    }
+    BlackList[j] = ident;
+    BlackListCount++;
+
+    return 0;
+}
+
+static void
+free_black_list(void)
+{
+    free(BlackList);
+    free(BlackListPath);
+    BlackList = NULL;
+    BlackListPath = NULL;
+    BlackListSize = 0;
+    BlackListCount = 0;
+}
 
 int
-set_black_list()
+set_black_list(const char *path)
 {
-    int str_size, inc = BL_SIZE_INC, ret_value = 1;
-    char line[MAX_BUFF_SIZE];
+    int ret_value = 1;
+    char line[MAX_BUFF_SIZE], *name = NULL, *end = NULL;
     FILE *f_in = NULL;
 
-    if (BlackList != NULL)
+    if (path == NULL)
     {
-        /* singleton */
-        ret_value = 0;
-        goto exit;
+        path = BLACK_LIST_PATH;
     }
 
-    BlackListCount = 0;
-    BlackList = malloc(BL_SIZE_INC * sizeof(**BlackList));
-    if (BlackList == NULL)
+    if (BlackListPath != NULL)
     {
-        perror("malloc");
-        goto exit;
+        /* singleton, as long as the list comes from the same file */
+        if (strcmp(BlackListPath, path) == 0)
+        {
+            ret_value = 0;
+            goto exit;
+        }
+        free_black_list();
     }
 
-    f_in = fopen("/tmp/black_list", "r");
+    f_in = fopen(path, "r");
     if (f_in == NULL)
     {
-        perror("fopen");
+        perror(path);
         goto exit;
     }
 
     while (fgets(line, MAX_BUFF_SIZE, f_in))
     {
-        str_size = strlen(line);
-        line[str_size - 1] = '\0';
+        for (name = line; isspace((unsigned char) *name); name++);
+        for (end = name + strlen(name); end > name && isspace((unsigned char) end[-1]); end--);
+        *end = '\0';
 
-        if (BlackListCount && (BlackListCount % BL_SIZE_INC) == 0)
+        if (*name == '\0')
         {
-            inc += BL_SIZE_INC;
-            BlackList = realloc(BlackList, sizeof(**BlackList) * inc);
-            if (BlackList == NULL)
-            {
-                goto exit;
-            }
+            continue;
+        }
+
+        if (add_black_listed(built_in_ident(name)) != 0)
+        {
+            perror("calloc");
+            free_black_list();
+            goto exit;
         }
+    }
 
-        BlackList[BlackListCount++] = strdup(line);
+    BlackListPath = strdup(path);
+    if (BlackListPath == NULL)
+    {
+        perror("strdup");
+        free_black_list();
+        goto exit;
     }
 
     ret_value = 0;
 
 exit:
+    if (f_in != NULL)
+    {
+        fclose(f_in);
+    }
     return ret_value;
 }
 
 int
-is_black_listed(char *func_name)
+is_black_listed(const struct ident *func_name)
 {
-    int is_listed = 0, i;
+    unsigned int i;
 
-    if (func_name == NULL) { goto exit; }
+    if (func_name == NULL || BlackListCount == 0)
+    {
+        return 0;
+    }
 
-    for (i = 0; i < BlackListCount; i++)
+    for (i = func_name->hash & (BlackListSize - 1); BlackList[i] != NULL; i = (i + 1) & (BlackListSize - 1))
     {
-        if (strcmp(BlackList[i], func_name) == 0)
+        if (BlackList[i] == func_name)
         {
-            is_listed = 1;
-            goto exit;
+            return 1;
         }
     }
 
-exit:
-    return is_listed;
+    return 0;
 }
@@ -9,13 +9,25 @@
 #define	BLACK_LIST_H
 
 #define MAX_BUFF_SIZE       1024
-#define BL_SIZE_INC         100
+#define BL_SIZE_INC         128     /* a power of two */
 
+/* the list the build installs, read when no -b file is given */
+#ifndef BLACK_LIST_PATH
+#define BLACK_LIST_PATH     "rbc_sparse_utils/black_list"
+#endif
+
+struct ident;
+
+/*
+ * Loads the functions whose return value must be checked, one name per
+ * line, from path (NULL - BLACK_LIST_PATH). The list is read again only
+ * when it comes from another file.
+ */
 int
-set_black_list(void);
+set_black_list(const char *);
 
 int
-is_black_listed(char *);
+is_black_listed(const struct ident *);
 
 #endif	/* BLACK_LIST_H */
 
@@ -6,11 +6,16 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 
 #include "black_list.h"
+#include "static_analyzer.h"
 
 #include "../lib.h"
 #include "../allocate.h"
@@ -22,21 +27,21 @@
 #define MAX_NUM(a, b) \
             ((a > b) ? a : b)
 
-enum Errors
-{
-    ERR_FUN_CALL = 1,
-    ERR_FUN_LINES,
-    ERR_TABS_SPACES,
-    ERR_TRAYLING_WS,
-    ERR_INCONSISTENT_INDENT,
-    ERR_FUN_INDENT_LEVEL,
-
-    ERR_MAX
-};
+#define MIN_NUM(a, b) \
+            ((a < b) ? a : b)
+
+#define MAX_JOBS            64
+#define READ_SIZE           4096
+/* the check of the records carrying the diagnostics of a worker */
+#define SA_DIAGNOSTICS      0
+#define USE_BUCKETS         1024
 
 /* CMD line configurable values */
 static int MaxLineCount = -1;
 static int MaxIndentLevel = 5;
+static int LazyExpansion = 0;
+static int ReportAllocations = 0;
+static char *TokenCacheDir = NULL;
 
 #ifdef VEC_ACCESS
 /* FIXME */
@@ -51,26 +56,123 @@ static int CurrentIndentLevel = -1;
 static int LastInstructionLine = -1;
 
 /* declarations */
-static char *AnalyzedFunction = NULL;
+static struct ident *AnalyzedFunction = NULL;
 static char *AssignmentVariable = NULL;
 static char *CurrentFile = NULL;
 
 static char *FileMapping = NULL;
-static int MappingIndex = 0, FileSize = 0;
-static int PrevLine = 0, CurrentLine = 0;
+static int FileSize = 0;
+
+/* where every line of the mapping starts, and the lines already checked */
+static int *LineOffsets = NULL;
+static char *LineChecked = NULL;
+static int LineCount = 0;
 
 static struct string_list *FileList = NULL;
-static struct symbol_list *FileFunctionList[1024] = { NULL };
-static int FileFunctionListSize = -1;
+
+/* the functions of every parsed file, in the order of the file list */
+DECLARE_PTR_VEC(file_vec_list, struct symbol_vec);
+static struct file_vec_list *FileFunctionList = NULL;
+
+/* what the visited marks of an expression point to */
+static char Visited;
+
+/* the statement vectors of the blocks, freed with the parsed files */
+DECLARE_PTR_VEC(block_vec_list, struct statement_vec);
+static struct block_vec_list *BlockVectors = NULL;
+
+/* where the findings go */
+static sa_report_t Report = NULL;
+static void *ReportData = NULL;
+static char *CurrentFunction = NULL;
+
+/* 0 - not initialized, 1 - ready */
+static int FrontEndState = 0;
+static jmp_buf FrontEndDied;
+
+/* -j: a worker analyzes the files WorkerId, WorkerId + WorkerJobs, ... */
+static int CurrentFileIndex = 0;
+static int WorkerId = 0, WorkerJobs = 1, WorkerFd = -1;
+
+/* the stderr of a worker, sent to the parent file by file */
+static FILE *WorkerErrors = NULL;
+
+/* what a worker writes for a finding, followed by the two strings */
+struct sa_record
+{
+    int pass;
+    int file;
+    int check;
+    int line;
+    int function_len;
+    int message_len;
+};
+
+struct sa_worker
+{
+    pid_t pid;
+    int fd;
+    char *buffer;
+    size_t size, used;
+};
+
+struct sa_finding
+{
+    int pass, file, seq, line;
+    enum sa_check check;
+    const char *function, *message;
+};
+
+/*
+ * The def-use index of the analyzed function: the statements are numbered
+ * in the order examine_statement() visits them, so a subtree is the range
+ * [du_first, du_last], and every name a statement reads (as lookup_var()
+ * would match it) lists the statements reading it, in increasing order.
+ */
+struct sa_use
+{
+    const char *name;
+    int *stmts;
+    int count, size;
+    int next;
+};
+
+struct sa_child
+{
+    int line;
+    int first;
+};
+
+static int UseStamp = 0, UseStmtCount = 0;
+static int UseBuckets[USE_BUCKETS];
+static struct sa_use *Uses = NULL;
+static int UseCount = 0, UseSize = 0;
+static struct sa_child *UseChildren = NULL;
+static int UseChildCount = 0, UseChildSize = 0;
 
 static void
 populate_symlist(struct symbol_list *list);
 
 static void
-parse_file_list (int argc, char **args, void * (* f_ptr)(struct statement *), int flags);
+populate_functions(struct symbol_list *list);
+
+static struct string_list *
+open_file_list (int argc, char **args);
+
+static void
+parse_file_list (struct string_list *filelist, void * (* f_ptr)(struct statement *), int flags);
+
+static void
+run_passes (struct string_list *filelist, int flags);
+
+static int
+run_workers (struct string_list *filelist, int jobs, int flags);
 
 static void
-parse_function_list (struct symbol_list *list, void * (* f_ptr)(struct statement *), int flags);
+parse_function_list (struct symbol_vec *list, void * (* f_ptr)(struct statement *), int flags);
+
+static struct statement_vec *
+get_block_statements(struct statement *stmt);
 
 static int
 examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statement *), int set_relation);
@@ -93,6 +195,27 @@ examine_preop(struct expression *expr);
 static int
 find_usages(struct statement *start_statement, struct expression *expr);
 
+static void
+build_use_index(struct statement *body);
+
+static void
+index_statement(struct statement *stmt);
+
+static void
+index_expression(struct expression *expr, int stmt);
+
+static unsigned int
+hash_use(const char *name);
+
+static struct sa_use *
+find_use(const char *name);
+
+static void
+add_use(const char *name, int stmt);
+
+static int
+is_used_after(struct statement *compound, int line, const char *name);
+
 static struct statement *
 get_expression_statement(struct expression *expr);
 
@@ -108,7 +231,7 @@ validate_expr(struct expression *expr);
 static int
 lookup_expression(struct expression *expr);
 
-static char *
+static struct ident *
 get_caller(struct expression *expr);
 
 static char *
@@ -118,7 +241,35 @@ static struct expression *
 get_last_expression(struct expression *expr);
 
 static void
-emit_error(char * current_file, char *func_name, int line, const char *err_msg);
+emit_error(char * current_file, struct ident *func_name, int line, const char *err_msg);
+
+static void
+report(enum sa_check check, int line, const char *fmt, ...);
+
+static void
+leave_front_end(void);
+
+static void
+send_finding(void *data, enum sa_check check, const char *file,
+             const char *function, int line, const char *message);
+
+static void
+leave_worker(void);
+
+static void
+send_diagnostics(int pass);
+
+static int
+write_all(int fd, const void *buff, size_t size);
+
+static int
+read_workers(struct sa_worker *workers, int jobs);
+
+static int
+compare_findings(const void *a, const void *b);
+
+static void
+merge_findings(struct sa_worker *workers, int jobs, char **file_names);
 
 static int
 check_start_statement(struct statement *start_statement, struct expression *expr);
@@ -141,6 +292,21 @@ get_call_node (struct expression *expr);
 static int
 continue_parsing(int flags);
 
+static void
+print_usage(const char *name);
+
+static void
+clear_run(void);
+
+static void
+free_arguments(char **args, int count);
+
+static int
+index_file_lines(void);
+
+static void
+free_file_lines(void);
+
 #ifdef VEC_ACCESS
 static void
 parse_init_statement(struct statement *stmt);
@@ -159,38 +325,101 @@ populate_symlist(struct symbol_list *list)
 	} END_FOR_EACH_PTR(sym);
 }
 
+/*
+ * -f: evaluates and expands only the function bodies, the only symbols
+ * the checks look at, and leaves the declarations of the headers alone.
+ */
 static void
-parse_file_list (int argc, char **args, void * (* f_ptr)(struct statement *), int flags)
+populate_functions(struct symbol_list *list)
 {
-    struct symbol_list * list = NULL;
-    struct string_list *filelist = NULL, *tmp_filelist = NULL;
-    char *file;
-    int index = 0;
+	struct symbol_list *functions = NULL;
+	struct symbol *sym, *type;
 
-    off_t length = -1;
-    int fd = -1, create_mapping = continue_parsing(flags);
+	FOR_EACH_PTR(list, sym) {
+		type = sym->ctype.base_type;
+		if (type && type->type == SYM_FN && type->stmt)
+			add_symbol(&functions, sym);
+	} END_FOR_EACH_PTR(sym);
 
-    if (f_ptr == NULL) { return; }
+	evaluate_symbol_list(functions);
+	populate_symlist(functions);
+	free_ptr_list(&functions);
+}
 
-    if (FileList == NULL)
+/*
+ * Returns the files named on the command line. The first run also
+ * initializes the front end with the switches found there.
+ */
+static struct string_list *
+open_file_list (int argc, char **args)
+{
+    struct symbol_list *list = NULL;
+    struct string_list *filelist = NULL;
+    int i;
+
+    if (FrontEndState == 0)
     {
         list = sparse_initialize(argc, args, &filelist);
-        tmp_filelist = filelist;
-        
-        populate_symlist(list);
-        FileFunctionListSize = 0;
+        /* kept by every run: evaluated before the files refer to them */
+        evaluate_symbol_list(list);
+        if (!LazyExpansion)
+        {
+            populate_symlist(list);
+        }
+        if (!ptr_list_empty(filelist))
+        {
+            protect_initial_state();
+            FrontEndState = 1;
+        }
     }
     else
     {
-        filelist = FileList;
+        /* the switches were handled by the first run */
+        for (i = 1; i <= argc; i++)
+        {
+            if (args[i][0] != '-')
+            {
+                add_ptr_list_notag(&filelist, args[i]);
+            }
+        }
     }
 
+    return filelist;
+}
+
+/*
+ * Runs f_ptr over the functions of every file. The first call parses the
+ * files, the following ones (FileList set) reuse their symbols.
+ */
+static void
+parse_file_list (struct string_list *filelist, void * (* f_ptr)(struct statement *), int flags)
+{
+    struct symbol_list * list = NULL;
+    struct symbol_vec *functions = NULL;
+    char *file;
+    int index = 0;
+
+    off_t length = -1;
+    int fd = -1, create_mapping = continue_parsing(flags);
+
+    if (f_ptr == NULL) { return; }
+
     FOR_EACH_PTR_NOTAG(filelist, file) {
         if (FileList == NULL)
         {
-            list = sparse(file);
-            populate_symlist(list);
-            FileFunctionList[FileFunctionListSize++] = list;
+            if (LazyExpansion)
+            {
+                list = __sparse(file);
+                populate_functions(list);
+            }
+            else
+            {
+                list = sparse(file);
+                populate_symlist(list);
+            }
+            /* read by every pass: walked as an array */
+            ptr_list_to_vec(list, functions);
+            add_ptr_vec(&FileFunctionList, functions);
         }
 
         CurrentFile = file;
@@ -211,17 +440,23 @@ parse_file_list (int argc, char **args, void * (* f_ptr)(struct statement *), in
                 goto close_file;
             }
 
-            FileMapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
-            if (FileMapping != NULL)
+            FileMapping = (length > 0) ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+            if (FileMapping == MAP_FAILED)
             {
-                FileSize = length;
-                MappingIndex = PrevLine = CurrentLine = 0;
-
-                goto parse;
+                perror("mmap");
+                FileMapping = NULL;
             }
-            else
+            else if (FileMapping != NULL)
             {
-                perror("mmap");
+                FileSize = length;
+                if (index_file_lines() == 0)
+                {
+                    goto parse;
+                }
+
+                perror("index_file_lines");
+                munmap(FileMapping, length);
+                FileMapping = NULL;
             }
 
 close_file:
@@ -229,12 +464,12 @@ close_file:
         }
 
 parse:
-        printf ("####From file: %s####\n", file);
-        parse_function_list(FileFunctionList[index++], f_ptr, flags);
-	printf ("####End parsing file####\n");
+        CurrentFileIndex = index;
+        parse_function_list(FileFunctionList->list[index++], f_ptr, flags);
 
         if (create_mapping && FileMapping != NULL)
         {
+            free_file_lines();
             if (munmap(FileMapping, length) == -1)
             {
                 perror("munmap");
@@ -242,19 +477,40 @@ parse:
 
             close(fd);
         }
+
+        if (WorkerErrors != NULL)
+        {
+            send_diagnostics((f_ptr == examine_stmt_expression) ? 0 : 1);
+        }
     } END_FOR_EACH_PTR_NOTAG(file);
 
     if (FileList == NULL)
     {
-        FileList = tmp_filelist;
+        FileList = filelist;
+    }
+}
+
+/*
+ * The statements of a block, copied to an array the first time: the
+ * parsed tree does not change and the passes walk it over and over.
+ */
+static struct statement_vec *
+get_block_statements(struct statement *stmt)
+{
+    if (stmt->stmt_vec == NULL && stmt->stmts != NULL)
+    {
+        ptr_list_to_vec(stmt->stmts, stmt->stmt_vec);
+        add_ptr_vec(&BlockVectors, stmt->stmt_vec);
     }
+
+    return stmt->stmt_vec;
 }
 
 static void
-parse_function_list (struct symbol_list *list, void * (* f_ptr)(struct statement *), int flags)
+parse_function_list (struct symbol_vec *list, void * (* f_ptr)(struct statement *), int flags)
 {
     struct symbol *sym = NULL, *type = NULL;
-    struct statement_list *instructions = NULL;
+    struct statement_vec *instructions = NULL;
     struct statement *instruction = NULL;
 
 #ifdef VEC_ACCESS
@@ -263,7 +519,7 @@ parse_function_list (struct symbol_list *list, void * (* f_ptr)(struct statement
 
     if (list != NULL)
     {
-        FOR_EACH_PTR(list, sym)
+        FOR_EACH_VEC(list, sym)
         {
             if (sym->ctype.base_type != NULL)
             {
@@ -272,37 +528,40 @@ parse_function_list (struct symbol_list *list, void * (* f_ptr)(struct statement
                 {
                     if (type->stmt && type->stmt->stmts)
                     {
-                        printf ("\t#####parsing function: %s#####\n", sym->ident->name);
+                        CurrentFunction = sym->ident->name;
 
                         CurrentIndentLevel = LastInstructionLine = -1;
                         type->stmt->indent_level = 0;
-                        instructions = type->stmt->stmts;
+                        instructions = get_block_statements(type->stmt);
                         GlobalFlags = flags;
 
-                        FOR_EACH_PTR(instructions, instruction)
+                        if (f_ptr == examine_stmt_expression)
+                        {
+                            build_use_index(type->stmt);
+                        }
+
+                        FOR_EACH_VEC(instructions, instruction)
                         {
                             instruction->prt_stmt = type->stmt;
                             examine_statement(instruction, f_ptr, 1);
-                        } END_FOR_EACH_PTR(instruction);
+                        } END_FOR_EACH_VEC(instruction);
 
-                        if (flags & (1<<ERR_FUN_INDENT_LEVEL) && CurrentIndentLevel >= MaxIndentLevel)
+                        if (flags & (1<<SA_FUN_INDENT_LEVEL) && CurrentIndentLevel >= MaxIndentLevel)
                         {
-                            printf ("\t\tIndent level: %d\n", CurrentIndentLevel);
+                            report(SA_FUN_INDENT_LEVEL, type->pos.line, "Indent level: %d", CurrentIndentLevel);
                         }
-                        if (flags & (1<<ERR_FUN_LINES))
+                        if (flags & (1<<SA_FUN_LINES))
                         {
                             int line_count = LastInstructionLine - type->pos.line + 1;
                             if (MaxLineCount <= 0 || (LastInstructionLine - type->pos.line + 1 >= MaxLineCount))
                             {
-                                printf ("\t\tFunction line count: %d\n", line_count);
+                                report(SA_FUN_LINES, type->pos.line, "Function line count: %d", line_count);
                             }
                         }
-
-			printf ("\t#####end parsing function#####\n");
                     }
                 }
             }
-        } END_FOR_EACH_PTR(sym);
+        } END_FOR_EACH_VEC(sym);
     }
 }
 
@@ -310,7 +569,7 @@ static int
 examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statement *), int set_relation)
 {
     struct statement *crt_statement = NULL;
-    struct statement_list *list = NULL;
+    struct statement_vec *list = NULL;
     int ret_value = 1, tmp_value;
 #ifdef VEC_ACCESS
     struct symbol *sym = NULL;
@@ -318,7 +577,7 @@ examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statem
 
     if (wrapper_func == NULL)
     {
-        fprintf(stdout, "WRAPPER FUNCTION passed to examine_statement is NULL\n");
+        fprintf(stderr, "WRAPPER FUNCTION passed to examine_statement is NULL\n");
         return 1;
     }
 
@@ -333,7 +592,7 @@ examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statem
         switch(stmt->type)
         {
             case STMT_ASM:
-                fprintf (stdout, "statement ASM not handled");
+                fprintf (stderr, "statement ASM not handled");
                 break;
             case STMT_CASE:
 #ifdef RBC_STMT_DBG
@@ -347,9 +606,9 @@ examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statem
 #ifdef RBC_STMT_DBG
                 printf ("COMPOUND");
 #endif
-                list = stmt->stmts;
+                list = get_block_statements(stmt);
                 ret_value = 1;
-                FOR_EACH_PTR(list, crt_statement)
+                FOR_EACH_VEC(list, crt_statement)
                 {
                     if (set_relation) { crt_statement->prt_stmt = stmt; }
 
@@ -358,12 +617,12 @@ examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statem
                     {
                         ret_value = 0;
                     }
-                } END_FOR_EACH_PTR(crt_statement);
+                } END_FOR_EACH_VEC(crt_statement);
 
                 return ret_value;
                 break;
             case STMT_CONTEXT:
-                printf ("CONTEXT");
+                fprintf (stderr, "CONTEXT");
                 break;
             case STMT_DECLARATION:
 #ifdef RBC_STMT_DBG
@@ -430,10 +689,10 @@ examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statem
                 return examine_statement(stmt->label_statement, wrapper_func, set_relation);
                 break;
             case STMT_NONE:
-                fprintf (stdout, "statement NONE not handled\n");
+                fprintf (stderr, "statement NONE not handled\n");
                 break;
             case STMT_RANGE:
-                fprintf (stdout, "statement RANGE not handled\n");
+                fprintf (stderr, "statement RANGE not handled\n");
                 break;
             case STMT_RETURN:
 #ifdef RBC_STMT_DBG
@@ -449,7 +708,7 @@ examine_statement(struct statement *stmt, void * (* wrapper_func) (struct statem
                 return examine_statement(stmt->switch_statement, wrapper_func, set_relation);
                 break;
             default:
-                fprintf (stdout, "statement NO STMT TYPE not handled\n");
+                fprintf (stderr, "statement NO STMT TYPE not handled\n");
         }
 #ifdef RBC_STMT_DBG
         printf("%d", stmt->pos.line);
@@ -567,11 +826,11 @@ examine_expression(struct expression *expr)
     {
         if (expr->visited1 == NULL)
         {
-            expr->visited1 = malloc(2);
+            expr->visited1 = &Visited;
         }
         else
         {
-            expr->visited2 = malloc(2);
+            expr->visited2 = &Visited;
         }
 
         switch (expr->type)
@@ -648,9 +907,11 @@ examine_expression(struct expression *expr)
                 return EXPR_STRING;
 
             case EXPR_INITIALIZER:
+#ifdef RBC_DBG_EXAMINE
                 printf("\n\t\tinit");
                 getchar();
                 printf ("\n\t\t end init");
+#endif
                 return EXPR_INITIALIZER;
 
             case EXPR_SELECT:
@@ -676,7 +937,7 @@ examine_expression(struct expression *expr)
                 return EXPR_SLICE;
 
             default:
-                printf("error - invalid expression");
+                fprintf(stderr, "error - invalid expression");
         }
     }
 
@@ -686,7 +947,7 @@ examine_expression(struct expression *expr)
 static int
 handle_call_simple(struct expression *expr)
 {
-    char *fun_name = NULL;
+    struct ident *fun_name = NULL;
     struct expression *temp_expr = NULL;
 
     if (expr != NULL)
@@ -791,11 +1052,19 @@ find_usages(struct statement *start_statement, struct expression *expr)
 
     while (next_statement != NULL && next_statement->type == STMT_COMPOUND)
     {
-        if (next_statement->stmts != NULL)
+        if (next_statement->du_stamp == UseStamp && next_statement->du_child_count >= 0)
+        {
+            if (is_used_after(next_statement, expr->pos.line, AssignmentVariable))
+            {
+                show_err = 0;
+                break;
+            }
+        }
+        else if (next_statement->stmts != NULL)
         {
             //printf ("next statement at %d\n", next_statement->pos.line);
 
-            FOR_EACH_PTR(next_statement->stmts, crt_statement)
+            FOR_EACH_VEC(get_block_statements(next_statement), crt_statement)
             {
                 if (crt_statement->pos.line > expr->pos.line)
                 {
@@ -808,49 +1077,505 @@ find_usages(struct statement *start_statement, struct expression *expr)
                         break;
                     }
                 }
-            }END_FOR_EACH_PTR(crt_statement);
+            }END_FOR_EACH_VEC(crt_statement);
+        }
+
+        if (show_err == 0) break;
+
+        next_statement = get_next_statement(next_statement->prt_stmt, next_statement->pos.line);
+    }
+
+    return show_err;
+}
+
+/*
+ * Indexes the function body once, before the call pass, so that
+ * find_usages() does a lookup in every enclosing block instead of
+ * walking the statements that follow the call.
+ */
+static void
+build_use_index(struct statement *body)
+{
+    int i;
+
+    for (i = 0; i < UseCount; i++)
+    {
+        free(Uses[i].stmts);
+    }
+    memset(UseBuckets, -1, sizeof (UseBuckets));
+    UseCount = UseChildCount = UseStmtCount = 0;
+
+    UseStamp++;
+    index_statement(body);
+
+    if (UseStmtCount < 0)
+    {
+        /* out of memory: find_usages() walks the statements as before */
+        UseStamp++;
+    }
+}
+
+/* Numbers the statements in the order examine_statement() visits them. */
+static void
+index_statement(struct statement *stmt)
+{
+    struct statement *crt_statement = NULL;
+    struct sa_child *temp = NULL;
+    int index, count, size;
+
+    if (stmt == NULL || UseStmtCount < 0)
+    {
+        return;
+    }
+
+    stmt->du_stamp = UseStamp;
+    stmt->du_first = UseStmtCount++;
+    stmt->du_child_count = -1;
+
+    switch (stmt->type)
+    {
+        case STMT_CASE:
+            index_statement(stmt->case_statement);
+            break;
+
+        case STMT_COMPOUND:
+            count = ptr_vec_size(get_block_statements(stmt));
+            if (UseChildCount + count > UseChildSize)
+            {
+                size = MAX_NUM(2 * UseChildSize, UseChildCount + count);
+                temp = realloc(UseChildren, size * sizeof (struct sa_child));
+                if (temp == NULL)
+                {
+                    UseStmtCount = -1;
+                    return;
+                }
+                UseChildren = temp;
+                UseChildSize = size;
+            }
+
+            /* the children of a block are looked up by line */
+            stmt->du_children = UseChildCount;
+            stmt->du_child_count = count;
+            UseChildCount += count;
+
+            index = 0;
+            FOR_EACH_VEC(stmt->stmt_vec, crt_statement)
+            {
+                if (crt_statement == NULL ||
+                    (index > 0 && crt_statement->pos.line < UseChildren[stmt->du_children + index - 1].line))
+                {
+                    stmt->du_child_count = -1;
+                    count = 0;
+                }
+
+                index_statement(crt_statement);
+                if (index < count)
+                {
+                    UseChildren[stmt->du_children + index].line = crt_statement->pos.line;
+                    UseChildren[stmt->du_children + index].first = crt_statement->du_first;
+                }
+                index++;
+            } END_FOR_EACH_VEC(crt_statement);
+            break;
+
+        case STMT_IF:
+            index_expression(stmt->if_conditional, stmt->du_first);
+            index_statement(stmt->if_true);
+            index_statement(stmt->if_false);
+            break;
+
+        case STMT_ITERATOR:
+            index_statement(stmt->iterator_pre_statement);
+            index_statement(stmt->iterator_statement);
+            index_statement(stmt->iterator_post_statement);
+            break;
+
+        case STMT_LABEL:
+            index_statement(stmt->label_statement);
+            break;
+
+        case STMT_RETURN:
+            index_expression(stmt->ret_value, stmt->du_first);
+            break;
+
+        case STMT_SWITCH:
+            index_expression(stmt->switch_expression, stmt->du_first);
+            index_statement(stmt->switch_statement);
+            break;
+
+        case STMT_EXPRESSION:
+            index_expression(stmt->expression, stmt->du_first);
+            break;
+
+        default:
+            break;
+    }
+
+    stmt->du_last = UseStmtCount - 1;
+}
+
+/* Records the names lookup_expression() would match in expr. */
+static void
+index_expression(struct expression *expr, int stmt)
+{
+    struct expression *fn_arg = NULL;
+
+    if (expr == NULL)
+    {
+        return;
+    }
+
+    add_use(build_symbol(expr), stmt);
+
+    switch (expr->type)
+    {
+        case EXPR_CALL:
+            FOR_EACH_PTR(expr->args, fn_arg)
+            {
+                index_expression(fn_arg, stmt);
+            } END_FOR_EACH_PTR(fn_arg);
+            break;
+
+        case EXPR_ASSIGNMENT:
+            index_expression(expr->right, stmt);
+            break;
+
+        case EXPR_BINOP:
+        case EXPR_COMPARE:
+        case EXPR_LOGICAL:
+        case EXPR_COMMA:
+            index_expression(expr->left, stmt);
+            index_expression(expr->right, stmt);
+            break;
+
+        case EXPR_PREOP:
+            index_expression(expr->unop, stmt);
+            break;
+
+        case EXPR_SYMBOL:
+            if (expr->symbol && expr->symbol->ident)
+            {
+                add_use(expr->symbol->ident->name, stmt);
+            }
+            break;
+
+        case EXPR_CAST:
+        case EXPR_FORCE_CAST:
+        case EXPR_IMPLIED_CAST:
+            index_expression(expr->cast_expression, stmt);
+            break;
+
+        case EXPR_SELECT:
+        case EXPR_CONDITIONAL:
+            index_expression(expr->conditional, stmt);
+            index_expression(expr->cond_true, stmt);
+            index_expression(expr->cond_false, stmt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static unsigned int
+hash_use(const char *name)
+{
+    unsigned int hash = 5381;
+
+    while (*name)
+    {
+        hash = hash * 33 + (unsigned char) *name++;
+    }
+
+    return hash % USE_BUCKETS;
+}
+
+static struct sa_use *
+find_use(const char *name)
+{
+    int i;
+
+    for (i = UseBuckets[hash_use(name)]; i >= 0; i = Uses[i].next)
+    {
+        if (strcmp(Uses[i].name, name) == 0)
+        {
+            return &Uses[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void
+add_use(const char *name, int stmt)
+{
+    struct sa_use *use = NULL;
+    void *temp = NULL;
+    unsigned int hash;
+
+    if (name == NULL || UseStmtCount < 0)
+    {
+        return;
+    }
+
+    use = find_use(name);
+    if (use == NULL)
+    {
+        if (UseCount == UseSize)
+        {
+            temp = realloc(Uses, (2 * UseSize + 16) * sizeof (struct sa_use));
+            if (temp == NULL)
+            {
+                UseStmtCount = -1;
+                return;
+            }
+            Uses = temp;
+            UseSize = 2 * UseSize + 16;
+        }
+
+        hash = hash_use(name);
+        use = &Uses[UseCount];
+        use->name = name;
+        use->stmts = NULL;
+        use->count = use->size = 0;
+        use->next = UseBuckets[hash];
+        UseBuckets[hash] = UseCount++;
+    }
+
+    /* statements are indexed in increasing order */
+    if (use->count > 0 && use->stmts[use->count - 1] == stmt)
+    {
+        return;
+    }
+
+    if (use->count == use->size)
+    {
+        temp = realloc(use->stmts, (2 * use->size + 4) * sizeof (int));
+        if (temp == NULL)
+        {
+            UseStmtCount = -1;
+            return;
+        }
+        use->stmts = temp;
+        use->size = 2 * use->size + 4;
+    }
+    use->stmts[use->count++] = stmt;
+}
+
+/*
+ * Tells if a statement of the block that starts after line (or one
+ * nested in it) reads name - what the walk in find_usages() finds.
+ */
+static int
+is_used_after(struct statement *compound, int line, const char *name)
+{
+    struct sa_child *children = UseChildren + compound->du_children;
+    struct sa_use *use = NULL;
+    int low = 0, high = compound->du_child_count, middle, first;
+
+    if (name == NULL || (use = find_use(name)) == NULL)
+    {
+        return 0;
+    }
+
+    /* the first child after the line */
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (children[middle].line > line)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    if (low == compound->du_child_count)
+    {
+        return 0;
+    }
+    first = children[low].first;
+
+    /* the first use in the following subtrees */
+    low = 0;
+    high = use->count;
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (use->stmts[middle] >= first)
+        {
+            high = middle;
         }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return low < use->count && use->stmts[low] <= compound->du_last;
+}
+
+static struct statement *
+get_expression_statement(struct expression *expr)
+{
+    struct statement *stmt = NULL;
+    struct expression *crs = expr;
+
+    while (crs)
+    {
+        if (crs->prt_stmt != NULL)
+        {
+            stmt = crs->prt_stmt;
+            break;
+        }
+
+        crs = crs->prt_expr;
+    }
+
+    return stmt;
+}
+
+static void
+emit_error(char * current_file, struct ident *func_name, int line, const char *err_msg)
+{
+    current_file = (current_file != NULL) ? current_file : (char *)"<NO FILE>";
+
+    report(SA_FUN_CALL, line, "%s in file '%s' for function call '%s' at line '%d'",
+           err_msg, current_file, (func_name != NULL) ? func_name->name : "<NO FILE>", line);
+}
+
+/* line - where the finding is: the statement, the call or the function */
+static void
+report(enum sa_check check, int line, const char *fmt, ...)
+{
+    char message[MAX_BUFF_SIZE];
+    va_list args;
+
+    if (Report == NULL) { return; }
+
+    va_start(args, fmt);
+    vsnprintf(message, sizeof (message), fmt, args);
+    va_end(args);
+
+    Report(ReportData, check, CurrentFile, CurrentFunction, line, message);
+}
+
+/* die() hook: back to run_static_analyzer() instead of exit() */
+static void
+leave_front_end(void)
+{
+    longjmp(FrontEndDied, 1);
+}
+
+/* Report of a worker: the finding goes to the parent through a pipe. */
+static void
+send_finding(void *data, enum sa_check check, const char *file,
+             const char *function, int line, const char *message)
+{
+    struct sa_record record;
 
-        if (show_err == 0) break;
+    (void) data;
+    (void) file;
 
-        next_statement = get_next_statement(next_statement->prt_stmt, next_statement->pos.line);
-    }
+    function = (function != NULL) ? function : "";
 
-    return show_err;
+    record.pass = (check == SA_FUN_CALL) ? 0 : 1;
+    record.file = WorkerId + WorkerJobs * CurrentFileIndex;
+    record.check = check;
+    record.line = line;
+    record.function_len = strlen(function) + 1;
+    record.message_len = strlen(message) + 1;
+
+    if (write_all(WorkerFd, &record, sizeof (record)) != 0 ||
+        write_all(WorkerFd, function, record.function_len) != 0 ||
+        write_all(WorkerFd, message, record.message_len) != 0)
+    {
+        perror("write");
+        _exit(EXIT_FAILURE);
+    }
 }
 
-static struct statement *
-get_expression_statement(struct expression *expr)
+/* die() hook of a worker: the parent sees the exit status */
+static void
+leave_worker(void)
 {
-    struct statement *stmt = NULL;
-    struct expression *crs = expr;
+    if (WorkerErrors != NULL)
+    {
+        send_diagnostics(0);
+    }
+    _exit(EXIT_FAILURE);
+}
 
-    while (crs)
+/*
+ * Sends what the worker wrote to stderr since the last call as one record
+ * of the current file, so that the parent prints the diagnostics once, in
+ * the order of a sequential run, instead of every worker on its own.
+ */
+static void
+send_diagnostics(int pass)
+{
+    struct sa_record record;
+    int fd = fileno(WorkerErrors);
+    char *text = NULL;
+    off_t size;
+
+    fflush(stderr);
+    size = lseek(fd, 0, SEEK_CUR);
+    if (size <= 0)
     {
-        if (crs->prt_stmt != NULL)
-        {
-            stmt = crs->prt_stmt;
-            break;
-        }
+        return;
+    }
 
-        crs = crs->prt_expr;
+    text = malloc(size + 1);
+    if (text == NULL || pread(fd, text, size, 0) != size)
+    {
+        free(text);
+        return;
+    }
+    text[size] = '\0';
+
+    record.pass = pass;
+    record.file = WorkerId + WorkerJobs * CurrentFileIndex;
+    record.check = SA_DIAGNOSTICS;
+    record.line = 0;
+    record.function_len = 1;
+    record.message_len = size + 1;
+
+    if (write_all(WorkerFd, &record, sizeof (record)) != 0 ||
+        write_all(WorkerFd, "", record.function_len) != 0 ||
+        write_all(WorkerFd, text, record.message_len) != 0)
+    {
+        _exit(EXIT_FAILURE);
     }
+    free(text);
 
-    return stmt;
+    if (ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) == -1)
+    {
+        _exit(EXIT_FAILURE);
+    }
 }
 
-static void
-emit_error(char * current_file, char *func_name, int line, const char *err_msg)
+static int
+write_all(int fd, const void *buff, size_t size)
 {
-    static char output_buffer[256];
-
-    current_file = (current_file != NULL) ? current_file : (char *)"<NO FILE>";
-    func_name = (func_name != NULL) ? func_name : (char *)"<NO FILE>";
+    const char *p = buff;
+    ssize_t count;
 
-    sprintf(output_buffer, "%s in file '%s' for function call '%s' at line '%d'",
-                            err_msg, current_file, func_name, line);
+    while (size > 0)
+    {
+        count = write(fd, p, size);
+        if (count == -1)
+        {
+            if (errno == EINTR) { continue; }
+            return -1;
+        }
+        p += count;
+        size -= count;
+    }
 
-    fprintf(stdout, "%s\n", output_buffer);
+    return 0;
 }
 
 struct statement *
@@ -861,7 +1586,7 @@ get_next_statement(struct statement *prt, int caller_line)
         switch(prt->type)
         {
             case STMT_ASM:
-                fprintf (stdout, "statement ASM not handled");
+                fprintf (stderr, "statement ASM not handled");
                 break;
 
             case STMT_CASE:
@@ -874,8 +1599,7 @@ get_next_statement(struct statement *prt, int caller_line)
                 }
                 else
                 {
-                    fprintf(stdout, "CASE NODE has parrent NULL");
-                    getchar();
+                    fprintf(stderr, "CASE NODE has parrent NULL");
                 }
                 break;
 
@@ -886,7 +1610,7 @@ get_next_statement(struct statement *prt, int caller_line)
                 return prt;
 
             case STMT_CONTEXT:
-                printf ("CONTEXT");
+                fprintf (stderr, "CONTEXT");
                 break;
 
             case STMT_DECLARATION:
@@ -915,8 +1639,7 @@ get_next_statement(struct statement *prt, int caller_line)
                 }
                 else
                 {
-                    fprintf(stdout, "EXPR NODE has parrent NULL");
-                    getchar();
+                    fprintf(stderr, "EXPR NODE has parrent NULL");
                 }
                 break;
 
@@ -930,8 +1653,7 @@ get_next_statement(struct statement *prt, int caller_line)
                 }
                 else
                 {
-                    fprintf(stdout, "IF NODE has parrent NULL");
-                    getchar();
+                    fprintf(stderr, "IF NODE has parrent NULL");
                 }
                 break;
 
@@ -945,8 +1667,7 @@ get_next_statement(struct statement *prt, int caller_line)
                 }
                 else
                 {
-                    fprintf(stdout, "ITERATOR NODE has parrent NULL");
-                    getchar();
+                    fprintf(stderr, "ITERATOR NODE has parrent NULL");
                 }
                 break;
 
@@ -960,17 +1681,16 @@ get_next_statement(struct statement *prt, int caller_line)
                 }
                 else
                 {
-                    fprintf(stdout, "LABEL NODE has parrent NULL");
-                    getchar();
+                    fprintf(stderr, "LABEL NODE has parrent NULL");
                 }
                 break;
 
             case STMT_NONE:
-                fprintf (stdout, "statement NONE not handled\n");
+                fprintf (stderr, "statement NONE not handled\n");
                 break;
 
             case STMT_RANGE:
-                fprintf (stdout, "statement RANGE not handled\n");
+                fprintf (stderr, "statement RANGE not handled\n");
                 break;
 
             case STMT_RETURN:
@@ -989,13 +1709,12 @@ get_next_statement(struct statement *prt, int caller_line)
                 }
                 else
                 {
-                    fprintf(stdout, "SWITCH NODE has parrent NULL");
-                    getchar();
+                    fprintf(stderr, "SWITCH NODE has parrent NULL");
                 }
                 break;
 
             default:
-                fprintf (stdout, "statement NO STMT TYPE not handled\n");
+                fprintf (stderr, "statement NO STMT TYPE not handled\n");
         }
 
 #ifdef RBC_NEXT
@@ -1158,19 +1877,15 @@ lookup_expression(struct expression *expr)
 
 	case EXPR_SELECT:
 	case EXPR_CONDITIONAL:
-#ifndef RBC_FIND_EXPR
+#ifdef RBC_FIND_EXPR
             printf("conditional");
 #endif
             if (!lookup_expression(expr->conditional))
             {
-                printf (" - ret 0");
-                getchar();
                 return 0;
             }
             else if (!lookup_expression(expr->cond_true))
             {
-                printf (" - ret 0");
-                getchar();
                 return 0;
             }
             return lookup_expression(expr->cond_false);
@@ -1254,15 +1969,15 @@ get_assignment_var(struct expression *expr)
     return build_symbol(expr);
 }
 
-static char *
+static struct ident *
 get_caller(struct expression *expr)
 {
-    char *fn_name = NULL;
+    struct ident *fn_name = NULL;
 
     if (expr && expr->fn &&
         expr->fn->symbol_name)
     {
-        fn_name = expr->fn->symbol_name->name;
+        fn_name = expr->fn->symbol_name;
     }
 
     return fn_name;
@@ -1289,6 +2004,7 @@ static void *
 examine_stmt_indent (struct statement *stmt)
 {
     static void *ret_ok = (void *)"OK";
+    int i;
 
     if (stmt != NULL)
     {
@@ -1301,47 +2017,45 @@ examine_stmt_indent (struct statement *stmt)
             stmt->indent_level = (stmt->prt_stmt) ? stmt->prt_stmt->indent_level + 1 : 1;
         }
 
-        if (FileMapping)
+        /* a line holding several statements is checked once */
+        if (FileMapping && stmt->pos.line >= 1 && stmt->pos.line <= LineCount &&
+            !LineChecked[stmt->pos.line - 1])
         {
-            int i;
-            int start_index = MappingIndex, end_index = 0;
+            int start_index = LineOffsets[stmt->pos.line - 1];
+            int end_index = (stmt->pos.line < LineCount) ? LineOffsets[stmt->pos.line] : FileSize;
             int tab_count = 0, space_count = 0;
 
-            for (i = CurrentLine; i < stmt->pos.line; i++)
-            {
-                PrevLine = CurrentLine;
-                start_index = MappingIndex;
+            LineChecked[stmt->pos.line - 1] = 1;
 
-                while (FileMapping[MappingIndex] != '\n') MappingIndex++;
-                CurrentLine++; MappingIndex++;
+            /* end_index - the new line, or the end of the last line */
+            if (end_index > start_index && FileMapping[end_index - 1] == '\n')
+            {
+                end_index--;
             }
-            
-            if (GlobalFlags & (1<<ERR_TABS_SPACES))
+
+            if (GlobalFlags & (1<<SA_TABS_SPACES))
             {
-                while (FileMapping[start_index] == ' ' || FileMapping[start_index] == '\t')
+                for (i = start_index; i < end_index && (FileMapping[i] == ' ' || FileMapping[i] == '\t'); i++)
                 {
-                    if (FileMapping[start_index] == ' ') { space_count++; }
-                    if (FileMapping[start_index] == '\t') { tab_count++; }
-                    start_index++;
+                    if (FileMapping[i] == ' ') { space_count++; }
+                    if (FileMapping[i] == '\t') { tab_count++; }
                 }
 
                 if (space_count && tab_count)
                 {
-                    printf ("\t\tMixed tabs with spaces. SPACES: %d TABS: %d at line %d\n",space_count, tab_count, stmt->pos.line);
+                    report(SA_TABS_SPACES, stmt->pos.line, "Mixed tabs with spaces. SPACES: %d TABS: %d at line %d",
+                           space_count, tab_count, stmt->pos.line);
                 }
             }
 
-            if (GlobalFlags & (1<<ERR_TRAYLING_WS))
+            if (GlobalFlags & (1<<SA_TRAILING_WS))
             {
-                end_index = MappingIndex - 2;
-                while (FileMapping[end_index] == ' ' || FileMapping[end_index] == '\t')
-                {
-                    end_index--;
-                }
+                for (i = end_index; i > start_index && (FileMapping[i - 1] == ' ' || FileMapping[i - 1] == '\t'); i--)
+                    ;
 
-                if (MappingIndex - end_index - 2 >= 2)
+                if (end_index - i >= 2)
                 {
-                    printf ("\t\tTrailing white space: at line %d\n", stmt->pos.line);
+                    report(SA_TRAILING_WS, stmt->pos.line, "Trailing white space: at line %d", stmt->pos.line);
                 }
             }
         }
@@ -1497,7 +2211,7 @@ get_out_symbol (struct expression *expr)
 
             default:
 #ifdef RBC_RBC_DEBUG
-                fprintf (stdout, "Unhandled out parameter type: %d\n", expr->type);
+                fprintf (stderr, "Unhandled out parameter type: %d\n", expr->type);
 #else
                 ; /* NOP */
 #endif
@@ -1555,7 +2269,7 @@ get_call_node (struct expression *expr)
                 return get_call_node(expr->base);
 
             default:
-                printf("error - invalid expression");
+                fprintf(stderr, "error - invalid expression");
         }
     }
 
@@ -1567,6 +2281,7 @@ build_symbol(struct expression *expr)
 {
     char *ret_string = NULL, *tmp = NULL;
     static char *end_string = (char *)"vec_acc";
+    struct ident *ident = NULL;
 
     if (expr)
     {
@@ -1618,11 +2333,14 @@ build_symbol(struct expression *expr)
 #else
                 if (tmp)
                 {
-                    ret_string = malloc(strlen(tmp) + strlen(end_string) + 1);
+                    /* interned like the symbol names: no caller frees it */
+                    ret_string = malloc(strlen(tmp) + strlen(end_string) + 2);
                     if (ret_string)
                     {
                         sprintf(ret_string, "%s_%s", tmp, end_string);
-                        return ret_string;
+                        ident = built_in_ident(ret_string);
+                        free(ret_string);
+                        return ident->name;
                     }
                 }
 #endif
@@ -1678,12 +2396,66 @@ parse_init_statement(struct statement *stmt)
 }
 #endif
 
+/*
+ * Indexes the lines of FileMapping, so that the checks reach the line of
+ * a statement directly, whatever the order the statements come in.
+ */
+static int
+index_file_lines(void)
+{
+    const char *p = FileMapping, *end = FileMapping + FileSize;
+    int size = 1024, *temp = NULL;
+
+    LineCount = 0;
+    LineOffsets = malloc(size * sizeof (int));
+    if (LineOffsets == NULL)
+    {
+        return -1;
+    }
+
+    LineOffsets[LineCount++] = 0;
+    while ((p = memchr(p, '\n', end - p)) != NULL && ++p < end)
+    {
+        if (LineCount == size)
+        {
+            size *= 2;
+            temp = realloc(LineOffsets, size * sizeof (int));
+            if (temp == NULL)
+            {
+                free_file_lines();
+                return -1;
+            }
+            LineOffsets = temp;
+        }
+        LineOffsets[LineCount++] = p - FileMapping;
+    }
+
+    LineChecked = calloc(LineCount, 1);
+    if (LineChecked == NULL)
+    {
+        free_file_lines();
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+free_file_lines(void)
+{
+    free(LineOffsets);
+    free(LineChecked);
+    LineOffsets = NULL;
+    LineChecked = NULL;
+    LineCount = 0;
+}
+
 static int
 continue_parsing(int flags)
 {
    int i;
 
-   for (i = ERR_FUN_CALL + 1; i < ERR_MAX; i++)
+   for (i = SA_FUN_CALL + 1; i < SA_MAX; i++)
    {
        if (flags & (1<<i))
        {
@@ -1694,99 +2466,503 @@ continue_parsing(int flags)
     return 0;
 }
 
-int main(int argc, char **argv)
+static void
+run_passes (struct string_list *filelist, int flags)
+{
+    if (flags & (1<<SA_FUN_CALL))
+    {
+        parse_file_list(filelist, examine_stmt_expression, 1<<SA_FUN_CALL);
+
+        flags &= ~(1<<SA_FUN_CALL);
+    }
+
+    if (continue_parsing(flags))
+    {
+        parse_file_list(filelist, examine_stmt_indent, flags);
+    }
+}
+
+/*
+ * Analyzes the files in jobs forked workers, which share the initialized
+ * front end copy-on-write. The findings come back through pipes and are
+ * reported in the order of a sequential run.
+ *
+ * returns: 0 - success / -1 - a worker could not be started or failed
+ */
+static int
+run_workers (struct string_list *filelist, int jobs, int flags)
+{
+    struct sa_worker workers[MAX_JOBS];
+    struct string_list *own_files = NULL;
+    char *file, **file_names = NULL;
+    int i, index, status = 0, file_count = 0, fds[2], child_status;
+
+    file_names = malloc(ptr_list_size((struct ptr_list *)filelist) * sizeof (char *));
+    if (file_names == NULL)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    FOR_EACH_PTR_NOTAG(filelist, file) {
+        file_names[file_count++] = file;
+    } END_FOR_EACH_PTR_NOTAG(file);
+
+    /* the workers must not flush what was buffered before the fork */
+    fflush(NULL);
+
+    for (i = 0; i < jobs; i++)
+    {
+        workers[i].pid = -1;
+        workers[i].fd = -1;
+        workers[i].buffer = NULL;
+        workers[i].size = workers[i].used = 0;
+
+        if (pipe(fds) == -1)
+        {
+            perror("pipe");
+            status = -1;
+            break;
+        }
+
+        workers[i].pid = fork();
+        if (workers[i].pid == -1)
+        {
+            perror("fork");
+            close(fds[0]);
+            close(fds[1]);
+            status = -1;
+            break;
+        }
+
+        if (workers[i].pid == 0)
+        {
+            close(fds[0]);
+
+            WorkerId = i;
+            WorkerJobs = jobs;
+            WorkerFd = fds[1];
+            Report = send_finding;
+            die_hook = leave_worker;
+
+            /* the diagnostics of the front end go through the pipe too */
+            WorkerErrors = tmpfile();
+            if (WorkerErrors == NULL)
+            {
+                perror("tmpfile");
+            }
+            else if (dup2(fileno(WorkerErrors), STDERR_FILENO) == -1)
+            {
+                perror("dup2");
+                fclose(WorkerErrors);
+                WorkerErrors = NULL;
+            }
+
+            for (index = i; index < file_count; index += jobs)
+            {
+                add_ptr_list_notag(&own_files, file_names[index]);
+            }
+
+            run_passes(own_files, flags);
+            _exit(EXIT_SUCCESS);
+        }
+
+        close(fds[1]);
+        workers[i].fd = fds[0];
+    }
+    jobs = i;
+
+    if (read_workers(workers, jobs) != 0)
+    {
+        status = -1;
+    }
+
+    for (i = 0; i < jobs; i++)
+    {
+        if (waitpid(workers[i].pid, &child_status, 0) == -1 ||
+            !WIFEXITED(child_status) || WEXITSTATUS(child_status) != EXIT_SUCCESS)
+        {
+            status = -1;
+        }
+    }
+
+    /* what the workers found is reported even if one of them failed */
+    merge_findings(workers, jobs, file_names);
+
+    for (i = 0; i < jobs; i++)
+    {
+        free(workers[i].buffer);
+    }
+    free(file_names);
+
+    return status;
+}
+
+/* Reads the pipes of the workers until all of them are closed. */
+static int
+read_workers(struct sa_worker *workers, int jobs)
+{
+    struct pollfd fds[MAX_JOBS];
+    int i, open_count = jobs;
+    ssize_t count;
+    char *temp;
+
+    for (i = 0; i < jobs; i++)
+    {
+        fds[i].fd = workers[i].fd;
+        fds[i].events = POLLIN;
+    }
+
+    while (open_count > 0)
+    {
+        if (poll(fds, jobs, -1) == -1)
+        {
+            if (errno == EINTR) { continue; }
+            perror("poll");
+            return -1;
+        }
+
+        for (i = 0; i < jobs; i++)
+        {
+            if (fds[i].fd == -1 || fds[i].revents == 0) { continue; }
+
+            if (workers[i].size - workers[i].used < READ_SIZE)
+            {
+                workers[i].size = workers[i].size ? 2 * workers[i].size : 4 * READ_SIZE;
+                temp = realloc(workers[i].buffer, workers[i].size);
+                if (temp == NULL)
+                {
+                    perror("realloc");
+                    return -1;
+                }
+                workers[i].buffer = temp;
+            }
+
+            count = read(fds[i].fd, workers[i].buffer + workers[i].used, READ_SIZE);
+            if (count > 0)
+            {
+                workers[i].used += count;
+            }
+            else if (count == 0 || errno != EINTR)
+            {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                open_count--;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int
+compare_findings(const void *a, const void *b)
+{
+    const struct sa_finding *x = a, *y = b;
+
+    if (x->pass != y->pass) { return x->pass - y->pass; }
+    if (x->file != y->file) { return x->file - y->file; }
+
+    return x->seq - y->seq;
+}
+
+/*
+ * Reports the findings of the workers: all the call errors, file by
+ * file, then all the other errors, as a sequential run would. Their
+ * diagnostics are written to stderr in the same order.
+ */
+static void
+merge_findings(struct sa_worker *workers, int jobs, char **file_names)
+{
+    struct sa_finding *findings = NULL, *temp;
+    struct sa_record record;
+    int i, count = 0, size = 0;
+    size_t pos, next;
+
+    for (i = 0; i < jobs; i++)
+    {
+        for (pos = 0; pos + sizeof (record) <= workers[i].used; pos = next)
+        {
+            memcpy(&record, workers[i].buffer + pos, sizeof (record));
+            next = pos + sizeof (record) + record.function_len + record.message_len;
+            if (next > workers[i].used)
+            {
+                break; /* cut short by a failed worker */
+            }
+
+            if (count == size)
+            {
+                size = size ? 2 * size : 64;
+                temp = realloc(findings, size * sizeof (*findings));
+                if (temp == NULL)
+                {
+                    perror("realloc");
+                    goto exit;
+                }
+                findings = temp;
+            }
+
+            findings[count].pass = record.pass;
+            findings[count].file = record.file;
+            findings[count].seq = count;
+            findings[count].check = record.check;
+            findings[count].line = record.line;
+            findings[count].function = workers[i].buffer + pos + sizeof (record);
+            findings[count].message = findings[count].function + record.function_len;
+            count++;
+        }
+    }
+
+    qsort(findings, count, sizeof (*findings), compare_findings);
+
+    for (i = 0; i < count; i++)
+    {
+        if (findings[i].check == SA_DIAGNOSTICS)
+        {
+            fputs(findings[i].message, stderr);
+            continue;
+        }
+        Report(ReportData, findings[i].check, file_names[findings[i].file],
+               findings[i].function, findings[i].line, findings[i].message);
+    }
+
+exit:
+    free(findings);
+}
+
+static void
+print_usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c ][-l line count] [-i indent level] [-s trailing/mixed-begin] [-j jobs] [-f] [-p header] [-a] [-C cache dir] [-b black list] [file list]\n",
+            name);
+}
+
+/*
+ * Frees what the run parsed, so that a long-lived caller does not grow
+ * from one run to the next: only the front end of the first run (the
+ * builtins, the prelude headers) and the identifiers are kept.
+ */
+static void
+clear_run(void)
+{
+    struct statement_vec *vec = NULL;
+    struct symbol_vec *functions = NULL;
+
+    FOR_EACH_VEC(FileFunctionList, functions)
+    {
+        free_ptr_vec(&functions);
+    } END_FOR_EACH_VEC(functions);
+    free_ptr_vec(&FileFunctionList);
+
+    FOR_EACH_VEC(BlockVectors, vec)
+    {
+        free_ptr_vec(&vec);
+    } END_FOR_EACH_VEC(vec);
+    free_ptr_vec(&BlockVectors);
+
+    FileList = NULL;
+    clear_unit_state();
+}
+
+static void
+free_arguments(char **args, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        free(args[i]);
+    }
+    free(args);
+}
+
+/*
+ * The only entry point: parses the command line, runs the requested
+ * checks on every file and hands the findings to report.
+ */
+int
+run_static_analyzer(int argc, char **argv, sa_report_t report, void *data)
 {
-   int flags, opt, status = 0;
+   int flags, opt, status = 0, jobs = 1;
 
-   int new_argc, i;
+   int new_argc, i, prelude_nr = 0;
    char **new_argv = NULL;
+   const char *black_list = NULL, *prelude[MAX_PRELUDE_HEADERS];
+   struct string_list *filelist = NULL;
 
    if (argc < 2)
    {
-        fprintf(stderr, "Usage: %s [-c ][-l line count] [-i indent level] [-s trailing/mixed-begin] [file list]\n",
-                   argv[0]);
-        exit(EXIT_FAILURE);
+        print_usage(argv[0]);
+        return -1;
    }
 
    flags = 0;
-   int args = 1;
-   while ((opt = getopt(argc, argv, "cl:i:s:")) != -1)
+   MaxLineCount = -1;
+   MaxIndentLevel = 5;
+   LazyExpansion = 0;
+   ReportAllocations = 0;
+   free(TokenCacheDir);
+   TokenCacheDir = NULL;
+   token_cache_dir = NULL;
+   optind = 0; /* rescan from the start on every run (GNU getopt) */
+   while ((opt = getopt(argc, argv, "cl:i:s:j:fp:aC:b:")) != -1)
    {
        switch (opt)
        {
        case 'c':
-           flags |= 1<<ERR_FUN_CALL;
-           args++;
+           flags |= 1<<SA_FUN_CALL;
            break;
        case 'l':
            MaxLineCount = atoi(optarg);
-           flags |= 1<<ERR_FUN_LINES;
-
-           args += 2;
+           flags |= 1<<SA_FUN_LINES;
            break;
        case 'i':
            MaxIndentLevel = atoi(optarg);
-           flags |= 1<<ERR_FUN_INDENT_LEVEL;
-
-           args += 2;
+           flags |= 1<<SA_FUN_INDENT_LEVEL;
            break;
        case 's':
            if (optarg != NULL)
            {
                if (strcmp(optarg, "trailing") == 0)
                {
-                   flags |= 1<<ERR_TRAYLING_WS;
+                   flags |= 1<<SA_TRAILING_WS;
                }
                else if (strcmp(optarg, "mixed-begin") == 0)
                {
-                   flags |= 1<<ERR_TABS_SPACES;
+                   flags |= 1<<SA_TABS_SPACES;
                }
                else
                {
                    fprintf(stderr, "Usage: %s [-s trailing/mixed-begin]\n",
                                     argv[0]);
-                   exit(EXIT_FAILURE);
+                   return -1;
                }
-
-               args += 2;
            }
            break;
+       case 'j':
+           /* 0 - one worker per processor */
+           jobs = atoi(optarg);
+           if (jobs <= 0)
+           {
+               jobs = sysconf(_SC_NPROCESSORS_ONLN);
+           }
+           jobs = (jobs < 1) ? 1 : (jobs > MAX_JOBS) ? MAX_JOBS : jobs;
+           break;
+       case 'f':
+           LazyExpansion = 1;
+           break;
+       case 'p':
+           /* handed to the front end, which dies on one too many */
+           if (prelude_nr >= MAX_PRELUDE_HEADERS)
+           {
+               fprintf(stderr, "%s: too many prelude headers\n", argv[0]);
+               return -1;
+           }
+           prelude[prelude_nr++] = optarg;
+           break;
+       case 'a':
+           ReportAllocations = 1;
+           break;
+       case 'C':
+           /* created on first use, shared by the runs that name it */
+           if (mkdir(optarg, 0755) == -1 && errno != EEXIST)
+           {
+               perror(optarg);
+               break;
+           }
+           free(TokenCacheDir);
+           TokenCacheDir = strdup(optarg);
+           token_cache_dir = TokenCacheDir;
+           break;
+       case 'b':
+           black_list = optarg;
+           break;
        default: /* '?' */
-           fprintf(stderr, "Usage: %s [-c ][-l line count] [-i indent level] [-s trailing/mixed-begin] [file list]\n",
-                   argv[0]);
-           exit(EXIT_FAILURE);
+           print_usage(argv[0]);
+           return -1;
        }
    }
 
-   status = set_black_list();
-   if (status)
+   /* the prelude headers are registered by sparse_initialize, once */
+   if (FrontEndState != 0)
    {
-       perror("black list creation");
-       exit(EXIT_FAILURE);
+       prelude_nr = 0;
    }
-
-   new_argc = argc - args + 1;
+   new_argc = argc - optind + 1 + 2 * prelude_nr;
    new_argv = malloc((new_argc + 1) * sizeof (char *));
+   if (new_argv == NULL)
+   {
+       perror("malloc");
+       return -1;
+   }
    new_argv[0] = strdup(argv[0]);
-   for (i = args; i < argc; i++)
+   for (i = 0; i < prelude_nr; i++)
+   {
+       new_argv[2 * i + 1] = strdup("-prelude");
+       new_argv[2 * i + 2] = strdup(prelude[i]);
+   }
+   for (i = optind; i < argc; i++)
+   {
+       new_argv[i - optind + 1 + 2 * prelude_nr] = strdup(argv[i]);
+   }
+   new_argv[new_argc] = NULL;
+
+   Report = report;
+   ReportData = data;
+   FileList = NULL;
+
+   /* the files may have changed since the last run */
+   clear_include_cache();
+
+   die_hook = leave_front_end;
+   if (setjmp(FrontEndDied) != 0)
+   {
+       /* a run that dies after the initialization only loses its files */
+       if (FrontEndState == 1)
+       {
+           clear_run();
+       }
+       status = -1;
+       goto exit;
+   }
+
+   filelist = open_file_list(new_argc - 1, new_argv);
+
+   /* after the front end, which interns the identifiers it knows itself */
+   if (set_black_list(black_list) != 0)
    {
-       new_argv[i - args + 1] = strdup(argv[i]);
+       fprintf(stderr, "%s: could not load the black list\n", argv[0]);
+       status = -1;
+       clear_run();
+       goto exit;
    }
 
-   if (flags & (1<<ERR_FUN_CALL))
+   jobs = MAX_NUM(1, MIN_NUM(jobs, ptr_list_size((struct ptr_list *)filelist)));
+
+   if (jobs > 1)
+   {
+       status = run_workers(filelist, jobs, flags);
+   }
+   else
    {
-       printf ("\t\t\t\tCall Errors:\n");        
-       parse_file_list(new_argc - 1, new_argv, examine_stmt_expression, 1<<ERR_FUN_CALL);
+       run_passes(filelist, flags);
+   }
 
-       flags &= ~(1<<ERR_FUN_CALL);
+   if (ReportAllocations)
+   {
+       report_allocations(stderr);
    }
+   clear_run();
 
-   if (continue_parsing(flags))
+exit:
+   die_hook = NULL;
+   Report = NULL;
+   /* with no file to keep it for, the next run initializes it again */
+   if (FrontEndState == 0)
    {
-       printf ("\t\t\t\tOther errors:\n");
-       parse_file_list(new_argc - 1, new_argv, examine_stmt_indent, flags);
+       reset_front_end();
    }
+   free_arguments(new_argv, new_argc);
 
-   return 0;
+   return status;
 }
-
@@ -0,0 +1,54 @@
+/*
+ * File:   static_analyzer.h
+ *
+ * Library entry point of the static analyzer, used by the static_analyzer
+ * program and, in-process, by the robocheck sparse module.
+ */
+
+#ifndef STATIC_ANALYZER_H
+#define	STATIC_ANALYZER_H
+
+enum sa_check
+{
+    SA_FUN_CALL = 1,
+    SA_FUN_LINES,
+    SA_TABS_SPACES,
+    SA_TRAILING_WS,
+    SA_INCONSISTENT_INDENT,
+    SA_FUN_INDENT_LEVEL,
+
+    SA_MAX
+};
+
+/*
+ * Called for every finding: check is the check that failed, file, function
+ * and line tell where (the line of the function for the checks of a whole
+ * function), message is the text of the finding (no new line). The strings
+ * are only valid during the call.
+ */
+typedef void (* sa_report_t) (void *data, enum sa_check check, const char *file,
+                              const char *function, int line, const char *message);
+
+/*
+ * Runs the analyzer with the command line of the static_analyzer program
+ * (argv[0] is ignored). The front end is initialized by the first call
+ * only, with its switches; the following calls reuse it and take the
+ * remaining arguments as file names. With -j N the files are analyzed by
+ * N forked workers (0 - one per processor) and the findings are reported
+ * in the order of a sequential run. With -f only the function bodies are
+ * evaluated and expanded, not the declarations the headers bring in.
+ * Every -p header is preprocessed once, when the front end is initialized,
+ * and the files including it then reuse its declarations. What a run
+ * parses is freed at its end; -a prints the allocator statistics of the
+ * run to stderr first, as tab separated lines. With -C dir the tokens of
+ * the headers are cached in dir and read back while a header does not
+ * change, by this run and by the following ones. -b file names the
+ * functions whose return value -c checks, one per line (the default is
+ * the list installed with the analyzer).
+ *
+ * returns: 0 - success / -1 - bad arguments or fatal front end error
+ */
+int
+run_static_analyzer (int argc, char **argv, sa_report_t report, void *data);
+
+#endif	/* STATIC_ANALYZER_H */
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "static_analyzer.h"
+
+static void
+print_finding(void *data, enum sa_check check, const char *file,
+              const char *function, int line, const char *message)
+{
+    (void) data;
+    (void) check;
+    (void) line;
+
+    printf("From file: %s at function: %s error: %s\n", file, function, message);
+}
+
+/* tabs, new lines and back slashes are escaped, the rest is written as is */
+static void
+print_field(const char *field, char end)
+{
+    const char *p = NULL;
+
+    for (p = (field != NULL) ? field : ""; *p != '\0'; p++)
+    {
+        switch (*p)
+        {
+        case '\t':
+            fputs("\\t", stdout);
+            break;
+        case '\n':
+            fputs("\\n", stdout);
+            break;
+        case '\\':
+            fputs("\\\\", stdout);
+            break;
+        default:
+            putchar(*p);
+        }
+    }
+    putchar(end);
+}
+
+/*
+ * With -m every finding is one line of tab separated fields: the file,
+ * the function, the line, the number of the check (enum sa_check) and
+ * the message.
+ */
+static void
+print_record(void *data, enum sa_check check, const char *file,
+             const char *function, int line, const char *message)
+{
+    (void) data;
+
+    print_field(file, '\t');
+    print_field(function, '\t');
+    printf("%d\t%d\t", line, (int) check);
+    print_field(message, '\n');
+}
+
+int main(int argc, char **argv)
+{
+    sa_report_t report = print_finding;
+    int i, j;
+
+    /* -m belongs to the program, the library sees the other arguments */
+    for (i = j = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-m") == 0)
+        {
+            report = print_record;
+            continue;
+        }
+        argv[j++] = argv[i];
+    }
+    argv[j] = NULL;
+
+    if (run_static_analyzer(j, argv, report, NULL) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
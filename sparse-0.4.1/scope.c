@@ -96,6 +96,171 @@ void new_file_scope(void)
 	start_file_scope();
 }
 
+/*
+ * What the translation units bind to the builtin scope (their externally
+ * visible symbols) comes after the symbols bound before the first file.
+ * clear_builtin_scope() unbinds it, together with the file scope, and
+ * undoes what the units did to the kept symbols: a tag they completed is
+ * incomplete again and no macro counts as used in the current file.
+ */
+struct kept_tag {
+	struct symbol *sym;
+	struct symbol saved;
+};
+
+static int kept_symbol_nr = -1;
+static struct kept_tag *kept_tags;
+static int kept_tag_nr;
+
+void protect_builtin_scope(void)
+{
+	struct symbol *sym;
+	int nr = 0;
+
+	kept_symbol_nr = symbol_list_size(builtin_scope.symbols);
+	FOR_EACH_PTR(builtin_scope.symbols, sym) {
+		/* examined now, a unit would leave its types in them */
+		if (sym->namespace == NS_STRUCT && !sym->symbol_list)
+			nr++;
+		else if (sym->namespace == NS_STRUCT ||
+			 (sym->namespace == NS_TYPEDEF && sym->type == SYM_NODE &&
+			  !sym->ident->reserved))
+			examine_symbol_type(sym);
+	} END_FOR_EACH_PTR(sym);
+
+	free(kept_tags);
+	kept_tags = nr ? malloc(nr * sizeof(*kept_tags)) : NULL;
+	if (nr && !kept_tags)
+		die("out of memory");
+	kept_tag_nr = 0;
+	FOR_EACH_PTR(builtin_scope.symbols, sym) {
+		if (sym->namespace == NS_STRUCT && !sym->symbol_list) {
+			kept_tags[kept_tag_nr].sym = sym;
+			kept_tags[kept_tag_nr++].saved = *sym;
+		}
+	} END_FOR_EACH_PTR(sym);
+}
+
+void clear_builtin_scope(void)
+{
+	struct symbol *sym;
+	int i = 0;
+
+	if (kept_symbol_nr < 0)
+		return;
+
+	if (file_scope != &builtin_scope) {
+		/* a unit left by die() may still be inside a function */
+		while (block_scope != file_scope)
+			end_scope(&block_scope);
+		while (function_scope != file_scope)
+			end_scope(&function_scope);
+		end_file_scope();
+	}
+	block_scope = function_scope = file_scope = &builtin_scope;
+
+	FOR_EACH_PTR(builtin_scope.symbols, sym) {
+		if (i++ >= kept_symbol_nr)
+			remove_symbol_scope(sym);
+		else if (sym->namespace == NS_MACRO)
+			sym->used_in = NULL;
+	} END_FOR_EACH_PTR(sym);
+	truncate_ptr_list(&builtin_scope.symbols, kept_symbol_nr);
+
+	for (i = 0; i < kept_tag_nr; i++)
+		*kept_tags[i].sym = kept_tags[i].saved;
+}
+
+/*
+ * The symbols of the builtin scope declared by the streams [first, end)
+ * are taken out of their identifiers until show_builtin_symbols() puts
+ * back those of a range, and rehide_builtin_symbols() takes them out
+ * again: a file sees them only once it includes what declared them.
+ */
+static struct symbol **hidden_symbols;
+static char *hidden_shown;
+static int hidden_symbol_nr;
+
+static void bind_hidden(struct symbol *sym)
+{
+	sym->next_id = *sym->id_list;
+	*sym->id_list = sym;
+}
+
+void hide_builtin_symbols(int first, int end)
+{
+	struct symbol *sym;
+	int nr = 0;
+
+	FOR_EACH_PTR(builtin_scope.symbols, sym) {
+		if (sym->pos.stream >= first && sym->pos.stream < end && sym->id_list)
+			nr++;
+	} END_FOR_EACH_PTR(sym);
+
+	free(hidden_symbols);
+	free(hidden_shown);
+	hidden_symbols = nr ? malloc(nr * sizeof(*hidden_symbols)) : NULL;
+	hidden_shown = nr ? calloc(nr, 1) : NULL;
+	if (nr && (!hidden_symbols || !hidden_shown))
+		die("out of memory");
+
+	hidden_symbol_nr = 0;
+	FOR_EACH_PTR(builtin_scope.symbols, sym) {
+		if (sym->pos.stream >= first && sym->pos.stream < end && sym->id_list) {
+			remove_symbol_scope(sym);
+			hidden_symbols[hidden_symbol_nr++] = sym;
+		}
+	} END_FOR_EACH_PTR(sym);
+}
+
+void show_builtin_symbols(int first, int end)
+{
+	int i;
+
+	for (i = 0; i < hidden_symbol_nr; i++) {
+		struct symbol *sym = hidden_symbols[i];
+
+		if (hidden_shown[i] || sym->pos.stream < first || sym->pos.stream >= end)
+			continue;
+		bind_hidden(sym);
+		hidden_shown[i] = 1;
+	}
+}
+
+void rehide_builtin_symbols(void)
+{
+	int i;
+
+	/* newest first, as they were bound */
+	for (i = hidden_symbol_nr - 1; i >= 0; i--) {
+		if (!hidden_shown[i])
+			continue;
+		remove_symbol_scope(hidden_symbols[i]);
+		hidden_shown[i] = 0;
+	}
+}
+
+/*
+ * Forgets the builtin scope for a front end initialized again, once the
+ * identifiers are unbound: what it pointed to goes with the allocations.
+ */
+void reset_builtin_scope(void)
+{
+	builtin_scope.symbols = NULL;
+	block_scope = function_scope = file_scope = global_scope = &builtin_scope;
+	kept_symbol_nr = -1;
+
+	free(kept_tags);
+	kept_tags = NULL;
+	kept_tag_nr = 0;
+
+	free(hidden_symbols);
+	free(hidden_shown);
+	hidden_symbols = NULL;
+	hidden_shown = NULL;
+	hidden_symbol_nr = 0;
+}
+
 void end_symbol_scope(void)
 {
 	end_scope(&block_scope);
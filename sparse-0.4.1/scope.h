@@ -38,5 +38,13 @@ extern void end_function_scope(void);
 
 extern void bind_scope(struct symbol *, struct scope *);
 
+extern void protect_builtin_scope(void);
+extern void clear_builtin_scope(void);
+
+extern void hide_builtin_symbols(int first, int end);
+extern void show_builtin_symbols(int first, int end);
+extern void rehide_builtin_symbols(void);
+extern void reset_builtin_scope(void);
+
 extern int is_outer_scope(struct scope *);
 #endif
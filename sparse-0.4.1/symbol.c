@@ -509,6 +509,26 @@ struct symbol *befoul(struct symbol *type)
 	return NULL;
 }
 
+/* The bitwise types declared before the first file are kept */
+static int kept_fouled_nr;
+
+void protect_fouled_types(void)
+{
+	kept_fouled_nr = symbol_list_size(restr);
+}
+
+void clear_fouled_types(void)
+{
+	truncate_ptr_list(&restr, kept_fouled_nr);
+	truncate_ptr_list(&fouled, kept_fouled_nr);
+}
+
+void reset_fouled_types(void)
+{
+	restr = fouled = NULL;
+	kept_fouled_nr = 0;
+}
+
 void check_declaration(struct symbol *sym)
 {
 	int warned = 0;
@@ -797,12 +817,20 @@ struct symbol	zero_int;
 
 void init_symbols(void)
 {
+	static int idents_hashed;
 	int stream = init_stream("builtin", -1, includepath);
 	struct sym_init *ptr;
 
+	/* once: the identifiers outlive reset_front_end(), reserved or not */
+	if (!idents_hashed) {
 #define __IDENT(n,str,res) \
 	hash_ident(&n)
 #include "ident-list.h"
+		idents_hashed = 1;
+	} else {
+		for (ptr = symbol_init_table; ptr->name; ptr++)
+			built_in_ident(ptr->name)->reserved = 0;
+	}
 
 	init_parser(stream);
 	for (ptr = symbol_init_table; ptr->name; ptr++) {
@@ -321,5 +321,8 @@ extern int is_ptr_type(struct symbol *);
 
 void create_fouled(struct symbol *type);
 struct symbol *befoul(struct symbol *type);
+void protect_fouled_types(void);
+void clear_fouled_types(void);
+void reset_fouled_types(void);
 
 #endif /* SYMBOL_H */
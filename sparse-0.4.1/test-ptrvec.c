@@ -0,0 +1,136 @@
+/*
+ * Micro-benchmark of the contiguous pointer vectors: walks the
+ * statements of every block of the parsed files through their
+ * ptr_list, then through a ptr_vec copy, and prints the cost
+ * of a statement for each.
+ *
+ *  Licensed under the Open Software License version 1.1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lib.h"
+#include "allocate.h"
+#include "token.h"
+#include "parse.h"
+#include "symbol.h"
+#include "expression.h"
+
+#define ROUNDS (200)
+
+static struct statement_list *blocks;
+
+static void collect_blocks(struct statement *stmt)
+{
+	struct statement *s;
+
+	if (!stmt)
+		return;
+
+	switch (stmt->type) {
+	case STMT_COMPOUND:
+		add_ptr_list(&blocks, stmt);
+		FOR_EACH_PTR(stmt->stmts, s) {
+			collect_blocks(s);
+		} END_FOR_EACH_PTR(s);
+		break;
+	case STMT_IF:
+		collect_blocks(stmt->if_true);
+		collect_blocks(stmt->if_false);
+		break;
+	case STMT_ITERATOR:
+		collect_blocks(stmt->iterator_pre_statement);
+		collect_blocks(stmt->iterator_statement);
+		collect_blocks(stmt->iterator_post_statement);
+		break;
+	case STMT_SWITCH:
+		collect_blocks(stmt->switch_statement);
+		break;
+	case STMT_CASE:
+		collect_blocks(stmt->case_statement);
+		break;
+	case STMT_LABEL:
+		collect_blocks(stmt->label_statement);
+		break;
+	default:
+		break;
+	}
+}
+
+static void collect_functions(struct symbol_list *list)
+{
+	struct symbol *sym;
+
+	FOR_EACH_PTR(list, sym) {
+		struct symbol *type = sym->ctype.base_type;
+		if (type && type->type == SYM_FN)
+			collect_blocks(type->stmt);
+	} END_FOR_EACH_PTR(sym);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct string_list *filelist = NULL;
+	struct statement_vec **vecs;
+	struct statement *block, *stmt;
+	double start, list_time, vec_time;
+	long sum_list = 0, sum_vec = 0, count = 0;
+	int i, round, nr;
+	char *file;
+
+	sparse_initialize(argc, argv, &filelist);
+	FOR_EACH_PTR_NOTAG(filelist, file) {
+		collect_functions(__sparse(file));
+	} END_FOR_EACH_PTR_NOTAG(file);
+
+	nr = ptr_list_size((struct ptr_list *)blocks);
+	vecs = calloc(nr ? nr : 1, sizeof(*vecs));
+	if (!vecs)
+		die("out of memory");
+
+	i = 0;
+	FOR_EACH_PTR(blocks, block) {
+		ptr_list_to_vec(block->stmts, vecs[i]);
+		count += ptr_vec_size(vecs[i]);
+		i++;
+	} END_FOR_EACH_PTR(block);
+
+	start = now();
+	for (round = 0; round < ROUNDS; round++) {
+		FOR_EACH_PTR(blocks, block) {
+			FOR_EACH_PTR(block->stmts, stmt) {
+				sum_list += stmt->type;
+			} END_FOR_EACH_PTR(stmt);
+		} END_FOR_EACH_PTR(block);
+	}
+	list_time = now() - start;
+
+	start = now();
+	for (round = 0; round < ROUNDS; round++) {
+		for (i = 0; i < nr; i++) {
+			FOR_EACH_VEC(vecs[i], stmt) {
+				sum_vec += stmt->type;
+			} END_FOR_EACH_VEC(stmt);
+		}
+	}
+	vec_time = now() - start;
+
+	if (sum_list != sum_vec)
+		die("ptr_vec walk does not match the ptr_list walk");
+
+	printf("%d blocks, %ld statements, %d rounds\n", nr, count, ROUNDS);
+	if (count) {
+		printf("ptr_list: %.2f ns/statement\n", list_time * 1e9 / (count * ROUNDS));
+		printf("ptr_vec:  %.2f ns/statement\n", vec_time * 1e9 / (count * ROUNDS));
+	}
+	return 0;
+}
@@ -44,6 +44,12 @@ struct stream {
 	struct ident *protect;
 	struct token *ifndef;
 	struct token *top_if;
+
+	/* The next stream in the same bucket of the name hash, or -1 */
+	int next_named;
+
+	/* The streams opened while this one was read end before this one */
+	int nested_end;
 };
 
 extern int input_stream_nr;
@@ -52,7 +58,8 @@ extern struct stream *input_streams;
 struct ident {
 	struct ident *next;	/* Hash chain of identifiers */
 	struct symbol *symbols;	/* Pointer to semantic meaning list */
-	unsigned char len;	/* Length of identifier name */
+	unsigned int hash;	/* Full hash of the name */
+	unsigned short len;	/* Length of identifier name, up to 256 */
 	unsigned char tainted:1,
 	              reserved:1,
 		      keyword:1;
@@ -186,19 +193,28 @@ extern struct token eof_token_entry;
 #define eof_token(x) ((x) == &eof_token_entry)
 
 extern int init_stream(const char *, int fd, const char **next_path);
+extern void clear_streams(int nr);
 extern const char *stream_name(int stream);
+extern int first_stream_named(const char *name);
+extern unsigned long hash_path(const char *name);
 extern struct ident *hash_ident(struct ident *);
 extern struct ident *built_in_ident(const char *);
+extern void clear_ident_symbols(void);
 extern struct token *built_in_token(int, const char *);
 extern const char *show_special(int);
 extern const char *show_ident(const struct ident *);
 extern const char *show_string(const struct string *string);
 extern const char *show_token(const struct token *);
 extern struct token * tokenize(const char *, int, struct token *, const char **next_path);
+extern struct token * tokenize_header(const char *, int, struct token *, const char **next_path);
 extern struct token * tokenize_buffer(void *, unsigned long, struct token *);
 
 extern void show_identifier_stats(void);
 extern struct token *preprocess(struct token *);
+extern void clear_include_cache(void);
+extern void reset_include_paths(void);
+
+extern const char *token_cache_dir;
 
 static inline int match_op(struct token *token, int op)
 {
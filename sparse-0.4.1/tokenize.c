@@ -13,7 +13,11 @@
 #include <stddef.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "lib.h"
 #include "allocate.h"
@@ -26,6 +30,10 @@ int input_stream_nr = 0;
 struct stream *input_streams;
 static int input_streams_allocated;
 
+/* The streams by name: the last one of each bucket, plus one */
+#define STREAM_HASH_SIZE (1024)
+static int stream_hash[STREAM_HASH_SIZE];
+
 #define BUFSIZE (8192)
 
 typedef struct {
@@ -70,7 +78,7 @@ const char *show_special(int val)
 
 const char *show_ident(const struct ident *ident)
 {
-	static char buffer[256];
+	static char buffer[256 + 1];
 	if (!ident)
 		return "<noident>";
 	sprintf(buffer, "%.*s", ident->len, ident->name);
@@ -186,10 +194,51 @@ int init_stream(const char *name, int fd, const char **next_path)
 	current->next_path = next_path;
 	current->path = NULL;
 	current->constant = CONSTANT_FILE_MAYBE;
+	if (name) {
+		unsigned long hash = hash_path(name) % STREAM_HASH_SIZE;
+		current->next_named = stream_hash[hash] - 1;
+		stream_hash[hash] = stream + 1;
+	} else
+		current->next_named = -1;
 	input_stream_nr = stream+1;
 	return stream;
 }
 
+/*
+ * Forgets the streams from nr on, the newest first, so that the name
+ * hash is left as it was when there were nr of them.
+ */
+void clear_streams(int nr)
+{
+	struct stream *s;
+
+	while (input_stream_nr > nr) {
+		s = input_streams + --input_stream_nr;
+		if (s->name)
+			stream_hash[hash_path(s->name) % STREAM_HASH_SIZE] = s->next_named + 1;
+		if (s->path && *s->path)
+			free((void *)s->path);
+	}
+}
+
+unsigned long hash_path(const char *name)
+{
+	unsigned long hash = 5381;
+
+	while (*name)
+		hash = hash * 33 + (unsigned char) *name++;
+	return hash;
+}
+
+/*
+ *  Returns a stream that may be named 'name', or -1; the others follow
+ *  through ->next_named. The caller compares the names.
+ */
+int first_stream_named(const char *name)
+{
+	return stream_hash[hash_path(name) % STREAM_HASH_SIZE] - 1;
+}
+
 static struct token * alloc_token(stream_t *stream)
 {
 	struct token *token = __alloc_token(0);
@@ -277,6 +326,10 @@ got_eof:
 	return EOF;
 }
 
+static const char special[256] = {
+	['\r'] = 1, ['\n'] = 1, ['\\'] = 1
+};
+
 /*
  *  We want that as light as possible while covering all normal cases.
  *  Slow path (including the logics with line-splicing and EOF sanity
@@ -288,9 +341,6 @@ static inline int nextchar(stream_t *stream)
 
 	if (offset < stream->size) {
 		int c = stream->buffer[offset++];
-		static const char special[256] = {
-			['\r'] = 1, ['\n'] = 1, ['\\'] = 1
-		};
 		if (!special[c]) {
 			stream->offset = offset;
 			stream->pos++;
@@ -300,22 +350,56 @@ static inline int nextchar(stream_t *stream)
 	return nextchar_slow(stream);
 }
 
-struct token eof_token_entry;
+/*
+ *  Skips the buffered characters nextchar() would return as they are,
+ *  up to (not including) 'stop'. The scans for the end of a comment or
+ *  of white space run through here, many bytes per call.
+ */
+static inline void skip_plain(stream_t *stream, int stop)
+{
+	const unsigned char *p = stream->buffer + stream->offset;
+	const unsigned char *end = stream->buffer + stream->size;
+	const unsigned char *start = p;
+
+	while (p < end && !special[*p] && *p != stop)
+		p++;
+	stream->offset += p - start;
+	stream->pos += p - start;
+}
 
-static void mark_eof(stream_t *stream, struct token *end_token)
+static inline void skip_blanks(stream_t *stream)
 {
-	struct token *end;
+	const unsigned char *p = stream->buffer + stream->offset;
+	const unsigned char *end = stream->buffer + stream->size;
+	const unsigned char *start = p;
+
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	stream->offset += p - start;
+	stream->pos += p - start;
+}
 
-	end = alloc_token(stream);
-	token_type(end) = TOKEN_STREAMEND;
-	end->pos.newline = 1;
+struct token eof_token_entry;
 
+/* What follows the end of a stream: end_token, or the end of all */
+static struct token *after_eof(struct token *end_token)
+{
 	eof_token_entry.next = &eof_token_entry;
 	eof_token_entry.pos.newline = 1;
 
 	if (!end_token)
 		end_token =  &eof_token_entry;
-	end->next = end_token;
+	return end_token;
+}
+
+static void mark_eof(stream_t *stream, struct token *end_token)
+{
+	struct token *end;
+
+	end = alloc_token(stream);
+	token_type(end) = TOKEN_STREAMEND;
+	end->pos.newline = 1;
+	end->next = after_eof(end_token);
 	*stream->tokenlist = end;
 	stream->tokenlist = NULL;
 }
@@ -580,6 +664,7 @@ static int drop_stream_eoln(stream_t *stream)
 {
 	drop_token(stream);
 	for (;;) {
+		skip_plain(stream, EOF);
 		switch (nextchar(stream)) {
 		case EOF:
 			return EOF;
@@ -603,6 +688,9 @@ static int drop_stream_comment(stream_t *stream)
 			warning(stream_pos(stream), "End of file in the middle of a comment");
 			return curr;
 		}
+		/* nothing before the next '*' can end the comment */
+		if (curr != '*')
+			skip_plain(stream, '*');
 		next = nextchar(stream);
 		if (curr == '*' && next == '/')
 			break;
@@ -724,17 +812,32 @@ static int get_one_special(int c, stream_t *stream)
 	return next;
 }
 
+/*
+ * FNV-1a over the name, kept whole in the ident; the table is doubled
+ * whenever it holds more idents than buckets.
+ */
 #define IDENT_HASH_BITS (13)
-#define IDENT_HASH_SIZE (1<<IDENT_HASH_BITS)
-#define IDENT_HASH_MASK (IDENT_HASH_SIZE-1)
 
-#define ident_hash_init(c)		(c)
-#define ident_hash_add(oldhash,c)	((oldhash)*11 + (c))
-#define ident_hash_end(hash)		((((hash) >> IDENT_HASH_BITS) + (hash)) & IDENT_HASH_MASK)
+#define ident_hash_init(c)		((2166136261u ^ (c)) * 16777619u)
+#define ident_hash_add(oldhash,c)	(((oldhash) ^ (c)) * 16777619u)
+#define ident_hash_end(hash)		((unsigned int) (hash))
 
-static struct ident *hash_table[IDENT_HASH_SIZE];
+static struct ident *initial_hash_table[1 << IDENT_HASH_BITS];
+static struct ident **hash_table = initial_hash_table;
+static unsigned int ident_hash_size = 1 << IDENT_HASH_BITS;
 static int ident_hit, ident_miss, idents;
 
+/* The identifiers outlive the symbols: a new front end binds them again */
+void clear_ident_symbols(void)
+{
+	struct ident *ident;
+	unsigned int i;
+
+	for (i = 0; i < ident_hash_size; i++)
+		for (ident = hash_table[i]; ident; ident = ident->next)
+			ident->symbols = NULL;
+}
+
 void show_identifier_stats(void)
 {
 	int i;
@@ -746,7 +849,7 @@ void show_identifier_stats(void)
 	for (i = 0; i < 100; i++)
 		distribution[i] = 0;
 
-	for (i = 0; i < IDENT_HASH_SIZE; i++) {
+	for (i = 0; i < ident_hash_size; i++) {
 		struct ident * ident = hash_table[i];
 		int count = 0;
 
@@ -775,43 +878,85 @@ static struct ident *alloc_ident(const char *name, int len)
 	return ident;
 }
 
-static struct ident * insert_hash(struct ident *ident, unsigned long hash)
+/*
+ *  Moves the idents to a table twice as big, keeping the order of each
+ *  chain. Without memory the old table is kept, only with longer chains.
+ */
+static void grow_hash(void)
+{
+	unsigned int i, size = ident_hash_size * 2;
+	struct ident **table, ***tails;
+
+	table = calloc(size, sizeof(*table));
+	tails = malloc(size * sizeof(*tails));
+	if (!table || !tails) {
+		free(table);
+		free(tails);
+		return;
+	}
+	for (i = 0; i < size; i++)
+		tails[i] = &table[i];
+
+	for (i = 0; i < ident_hash_size; i++) {
+		struct ident *ident = hash_table[i];
+		while (ident) {
+			struct ident *next = ident->next;
+			unsigned int bucket = ident->hash & (size - 1);
+			ident->next = NULL;
+			*tails[bucket] = ident;
+			tails[bucket] = &ident->next;
+			ident = next;
+		}
+	}
+
+	free(tails);
+	if (hash_table != initial_hash_table)
+		free(hash_table);
+	hash_table = table;
+	ident_hash_size = size;
+}
+
+static struct ident * insert_hash(struct ident *ident, unsigned int hash)
 {
-	ident->next = hash_table[hash];
-	hash_table[hash] = ident;
+	struct ident **p;
+
+	if (++idents > ident_hash_size)
+		grow_hash();
+	p = &hash_table[hash & (ident_hash_size - 1)];
+	ident->hash = hash;
+	ident->next = *p;
+	*p = ident;
 	ident_miss++;
 	return ident;
 }
 
-static struct ident *create_hashed_ident(const char *name, int len, unsigned long hash)
+static struct ident *create_hashed_ident(const char *name, int len, unsigned int hash)
 {
 	struct ident *ident;
 	struct ident **p;
 
-	p = &hash_table[hash];
+	p = &hash_table[hash & (ident_hash_size - 1)];
 	while ((ident = *p) != NULL) {
-		if (ident->len == (unsigned char) len) {
-			if (strncmp(name, ident->name, len) != 0)
-				goto next;
-
+		if (ident->hash == hash && ident->len == len &&
+		    !memcmp(name, ident->name, len)) {
 			ident_hit++;
 			return ident;
 		}
-next:
-		//misses++;
 		p = &ident->next;
 	}
 	ident = alloc_ident(name, len);
+	ident->hash = hash;
 	*p = ident;
 	ident->next = NULL;
 	ident_miss++;
-	idents++;
+	if (++idents > ident_hash_size)
+		grow_hash();
 	return ident;
 }
 
-static unsigned long hash_name(const char *name, int len)
+static unsigned int hash_name(const char *name, int len)
 {
-	unsigned long hash;
+	unsigned int hash;
 	const unsigned char *p = (const unsigned char *)name;
 
 	hash = ident_hash_init(*p++);
@@ -848,7 +993,7 @@ static int get_one_identifier(int c, stream_t *stream)
 {
 	struct token *token;
 	struct ident *ident;
-	unsigned long hash;
+	unsigned int hash;
 	char buf[256];
 	int len = 1;
 	int next;
@@ -856,6 +1001,17 @@ static int get_one_identifier(int c, stream_t *stream)
 	hash = ident_hash_init(c);
 	buf[0] = c;
 	for (;;) {
+		/* the letters and digits in the buffer are never spliced */
+		while (stream->offset < stream->size && len < sizeof(buf)) {
+			next = stream->buffer[stream->offset];
+			if (!(cclass[next + 1] & (Letter | Digit)))
+				break;
+			stream->offset++;
+			stream->pos++;
+			hash = ident_hash_add(hash, next);
+			buf[len] = next;
+			len++;
+		}
 		next = nextchar(stream);
 		if (!(cclass[next + 1] & (Letter | Digit)))
 			break;
@@ -923,6 +1079,7 @@ static void tokenize_stream(stream_t *stream, struct token *endtoken)
 			continue;
 		}
 		stream->whitespace = 1;
+		skip_blanks(stream);
 		c = nextchar(stream);
 	}
 	mark_eof(stream, endtoken);
@@ -938,11 +1095,50 @@ struct token * tokenize_buffer(void *buffer, unsigned long size, struct token *e
 	return begin;
 }
 
-struct token * tokenize(const char *name, int fd, struct token *endtoken, const char **next_path)
+/*
+ *  Regular files are mapped and scanned in place, the tokens do not
+ *  point into the buffer. Pipes and the like are read BUFSIZE at a time.
+ */
+static void *map_stream(int fd, unsigned int *size)
+{
+	struct stat st;
+	void *map;
+
+	if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+		return NULL;
+	if (st.st_size <= 0 || st.st_size > (1 << 30))
+		return NULL;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return NULL;
+	*size = st.st_size;
+	return map;
+}
+
+static struct token *tokenize_fd(int idx, int fd, struct token *endtoken)
 {
 	struct token *begin;
 	stream_t stream;
 	unsigned char buffer[BUFSIZE];
+	unsigned int size;
+	void *map;
+
+	map = map_stream(fd, &size);
+	if (map) {
+		begin = setup_stream(&stream, idx, -1, map, size);
+		tokenize_stream(&stream, endtoken);
+		munmap(map, size);
+		return begin;
+	}
+
+	begin = setup_stream(&stream, idx, fd, buffer, 0);
+	tokenize_stream(&stream, endtoken);
+	return begin;
+}
+
+struct token * tokenize(const char *name, int fd, struct token *endtoken, const char **next_path)
+{
 	int idx;
 
 	idx = init_stream(name, fd, next_path);
@@ -951,7 +1147,307 @@ struct token * tokenize(const char *name, int fd, struct token *endtoken, const
 		return endtoken;
 	}
 
-	begin = setup_stream(&stream, idx, fd, buffer, 0);
-	tokenize_stream(&stream, endtoken);
+	return tokenize_fd(idx, fd, endtoken);
+}
+
+/*
+ * The token cache: the tokens of a header, as tokenize() leaves them
+ * before any preprocessing, saved in token_cache_dir under the hash of
+ * the name. A cache file is used while the header keeps its device,
+ * inode, size and modification time; the macros do not matter, they
+ * only change what the preprocessor makes of the tokens.
+ *
+ * The file is the header below, the name, one token_record per token
+ * (the stream begin and end included) and the data the records point
+ * into: for an identifier its hash, length and name, for a number the
+ * digits and a NUL, for a string its length and bytes. The lengths are
+ * unsigned ints: an identifier may have 256 characters.
+ */
+const char *token_cache_dir;
+
+#define TOKEN_CACHE_MAGIC	0x43544b53	/* "SKTC" */
+#define TOKEN_CACHE_VERSION	2
+
+struct token_cache_header {
+	unsigned int magic, version, record_size;
+	unsigned int name_len, nr_tokens, data_size;
+	long long dev, ino, size, mtime, mtime_nsec;
+};
+
+/* the records follow the name, padded */
+#define NAME_SIZE(len)		(((len) + 7) & ~7)
+
+struct token_record {
+	struct position pos;
+	unsigned int value;		/* data offset, character or special */
+};
+
+static void cache_key(struct token_cache_header *header, const char *name, struct stat *st)
+{
+	memset(header, 0, sizeof(*header));
+	header->magic = TOKEN_CACHE_MAGIC;
+	header->version = TOKEN_CACHE_VERSION;
+	header->record_size = sizeof(struct token_record);
+	header->name_len = strlen(name);
+	header->dev = st->st_dev;
+	header->ino = st->st_ino;
+	header->size = st->st_size;
+	header->mtime = st->st_mtime;
+	header->mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+static char *cache_file(const char *name, char *buf, int size)
+{
+	if (snprintf(buf, size, "%s/%016lx.tok", token_cache_dir, hash_path(name)) >= size)
+		return NULL;
+	return buf;
+}
+
+static int record_data_size(struct token *token)
+{
+	switch (token_type(token)) {
+	case TOKEN_IDENT:
+		return 2 * sizeof(unsigned int) + token->ident->len;
+	case TOKEN_NUMBER:
+		return strlen(token->number) + 1;
+	case TOKEN_STRING:
+		return sizeof(unsigned int) + token->string->length;
+	default:
+		return 0;
+	}
+}
+
+static unsigned int record_value(struct token *token, char *data, unsigned int *offset)
+{
+	unsigned int start = *offset, len;
+	char *p = data + start;
+
+	switch (token_type(token)) {
+	case TOKEN_IDENT:
+		len = token->ident->len;
+		memcpy(p, &token->ident->hash, sizeof(unsigned int));
+		memcpy(p + sizeof(unsigned int), &len, sizeof(unsigned int));
+		memcpy(p + 2 * sizeof(unsigned int), token->ident->name, len);
+		break;
+	case TOKEN_NUMBER:
+		strcpy(p, token->number);
+		break;
+	case TOKEN_STRING:
+		memcpy(p, &token->string->length, sizeof(unsigned int));
+		memcpy(p + sizeof(unsigned int), token->string->data, token->string->length);
+		break;
+	case TOKEN_CHAR:
+		return token->character;
+	case TOKEN_SPECIAL:
+		return token->special;
+	default:
+		return 0;
+	}
+	*offset += record_data_size(token);
+	return start;
+}
+
+/*
+ * Saves the tokens from begin to the end of their stream. Written to a
+ * temporary file and renamed, a cache file is never seen half done;
+ * on any error there is just no cache file.
+ */
+static void save_tokens(const char *name, struct stat *st, struct token *begin)
+{
+	struct token_cache_header header;
+	struct token_record *records;
+	struct token *token = begin;
+	char path[PATH_MAX], tmp[PATH_MAX + 16], *buf, *data;
+	unsigned int nr = 0, data_size = 0, offset = 0, size;
+	int fd, ok;
+
+	if (!cache_file(name, path, sizeof(path)))
+		return;
+
+	for (;;) {
+		nr++;
+		data_size += record_data_size(token);
+		if (token_type(token) == TOKEN_STREAMEND)
+			break;
+		token = token->next;
+	}
+
+	cache_key(&header, name, st);
+	header.nr_tokens = nr;
+	header.data_size = data_size;
+
+	size = sizeof(header) + NAME_SIZE(header.name_len) + nr * sizeof(*records) + data_size;
+	buf = calloc(1, size);
+	if (!buf)
+		return;
+	memcpy(buf, &header, sizeof(header));
+	memcpy(buf + sizeof(header), name, header.name_len);
+	records = (struct token_record *)(buf + sizeof(header) + NAME_SIZE(header.name_len));
+	data = (char *)(records + nr);
+
+	for (token = begin, nr = 0; nr < header.nr_tokens; token = token->next, nr++) {
+		records[nr].pos = token->pos;
+		records[nr].value = record_value(token, data, &offset);
+	}
+
+	snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		ok = write(fd, buf, size) == size;
+		ok = !close(fd) && ok;
+		if (!ok || rename(tmp, path))
+			unlink(tmp);
+	}
+	free(buf);
+}
+
+static int bad_record(struct token_record *record, unsigned int data_size, const char *data)
+{
+	unsigned int value = record->value, len;
+
+	switch (record->pos.type) {
+	case TOKEN_IDENT:
+		if (value > data_size || data_size - value < 2 * sizeof(unsigned int))
+			return 1;
+		memcpy(&len, data + value + sizeof(unsigned int), sizeof(unsigned int));
+		return !len || len > 256 || data_size - value - 2 * sizeof(unsigned int) < len;
+	case TOKEN_NUMBER:
+		return value >= data_size || !memchr(data + value, 0, data_size - value);
+	case TOKEN_STRING:
+		if (value > data_size || data_size - value < sizeof(unsigned int))
+			return 1;
+		memcpy(&len, data + value, sizeof(unsigned int));
+		return !len || len > MAX_STRING + 1 ||
+			data_size - value - sizeof(unsigned int) < len;
+	case TOKEN_CHAR:
+	case TOKEN_SPECIAL:
+	case TOKEN_STREAMBEGIN:
+	case TOKEN_STREAMEND:
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+static struct token *load_record(struct token_record *record, const char *data, int idx)
+{
+	struct token *token = __alloc_token(0);
+	const char *p = data + record->value;
+	unsigned int hash, len;
+	char *number;
+
+	token->pos = record->pos;
+	token->pos.stream = idx;
+
+	switch (token_type(token)) {
+	case TOKEN_IDENT:
+		memcpy(&hash, p, sizeof(unsigned int));
+		memcpy(&len, p + sizeof(unsigned int), sizeof(unsigned int));
+		token->ident = create_hashed_ident(p + 2 * sizeof(unsigned int), len, hash);
+		break;
+	case TOKEN_NUMBER:
+		len = strlen(p) + 1;
+		number = __alloc_bytes(len);
+		memcpy(number, p, len);
+		token->number = number;
+		break;
+	case TOKEN_STRING:
+		memcpy(&len, p, sizeof(unsigned int));
+		token->string = __alloc_string(len);
+		token->string->length = len;
+		memcpy(token->string->data, p + sizeof(unsigned int), len);
+		break;
+	case TOKEN_CHAR:
+		token->character = record->value;
+		break;
+	case TOKEN_SPECIAL:
+		token->special = record->value;
+		break;
+	}
+	return token;
+}
+
+/*
+ * Returns the cached tokens of the header, in stream idx and followed
+ * by end_token, or NULL when the cache file is missing, stale or bad.
+ */
+static struct token *load_tokens(const char *name, struct stat *st, int idx, struct token *end_token)
+{
+	struct token_cache_header header, key;
+	struct token_record *records;
+	struct token *begin = NULL, **next = &begin;
+	struct stat cache_st;
+	char path[PATH_MAX], *map, *data;
+	unsigned int i;
+	int fd;
+
+	if (!cache_file(name, path, sizeof(path)))
+		return NULL;
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &cache_st) < 0 || cache_st.st_size < (off_t)sizeof(header)) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	cache_key(&key, name, st);
+	memcpy(&header, map, sizeof(header));
+	key.nr_tokens = header.nr_tokens;
+	key.data_size = header.data_size;
+	if (memcmp(&header, &key, sizeof(header)) ||
+	    header.nr_tokens < 2 || header.nr_tokens > cache_st.st_size / sizeof(*records) ||
+	    cache_st.st_size != (off_t)(sizeof(header) + NAME_SIZE(header.name_len) +
+					header.nr_tokens * sizeof(*records) + header.data_size) ||
+	    memcmp(map + sizeof(header), name, header.name_len))
+		goto out;
+
+	records = (struct token_record *)(map + sizeof(header) + NAME_SIZE(header.name_len));
+	data = (char *)(records + header.nr_tokens);
+	for (i = 0; i < header.nr_tokens; i++) {
+		if (bad_record(records + i, header.data_size, data) ||
+		    (records[i].pos.type == TOKEN_STREAMBEGIN) != (i == 0) ||
+		    (records[i].pos.type == TOKEN_STREAMEND) != (i == header.nr_tokens - 1))
+			goto out;
+	}
+
+	for (i = 0; i < header.nr_tokens; i++) {
+		*next = load_record(records + i, data, idx);
+		next = &(*next)->next;
+	}
+	*next = after_eof(end_token);
+
+out:
+	munmap(map, cache_st.st_size);
+	return begin;
+}
+
+/*
+ * tokenize() for a header: with token_cache_dir set, the tokens come
+ * from the cache when it is up to date, and are saved there otherwise.
+ */
+struct token * tokenize_header(const char *name, int fd, struct token *endtoken, const char **next_path)
+{
+	struct token *begin;
+	struct stat st;
+	int idx;
+
+	if (!token_cache_dir || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+		return tokenize(name, fd, endtoken, next_path);
+
+	idx = init_stream(name, fd, next_path);
+	if (idx < 0)
+		return endtoken;
+
+	begin = load_tokens(name, &st, idx, endtoken);
+	if (begin)
+		return begin;
+
+	begin = tokenize_fd(idx, fd, endtoken);
+	save_tokens(name, &st, begin);
 	return begin;
 }
@@ -14,6 +14,7 @@
 
 #include "../include/utils.h"
 #include "../include/librobocheck.h"
+#include "../lib/rbc_elf.h"
 
 
 extern rbc_xml_doc __root;
@@ -27,6 +28,27 @@ static struct rbc_out_info * (* apply_penalty_ptr) (enum EN_err_type , int );
 static int __output_size = 0, __output_inc_count = 0;
 static struct rbc_output **__output = NULL;
 
+struct rbc_skipped_tool
+{
+	char *tool_name;
+	char *reason;
+};
+
+static int __skipped_count = 0;
+static struct rbc_skipped_tool *__skipped = NULL;
+static unsigned int __exec_caps = RBC_CAP_NONE;
+static int __exec_inspected = 0;
+
+/* the number of errors reported by each tool that ran */
+struct rbc_tool_run
+{
+	char *tool_name;
+	int err_count;
+};
+
+static int __run_count = 0;
+static struct rbc_tool_run *__runs = NULL;
+
 
 #ifdef RBC_DEBUG
 static void
@@ -54,6 +76,24 @@ add_range(struct rbc_output * );
 static void
 close_library_handlers(void);
 
+static int
+check_tool_requirements(rbc_xml_node , const char *);
+
+static void
+add_skipped_tool(const char *, const char *);
+
+static void
+free_skipped_tools(void);
+
+static int
+check_tool_fallback(rbc_xml_node , const char *, rbc_errset_t *);
+
+static void
+add_tool_run(const char *, struct rbc_output *);
+
+static void
+free_tool_runs(void);
+
 static void
 close_library_handlers(void)
 {
@@ -90,6 +130,7 @@ close_robocheck (void)
 		{
 			free (__static_ptr->file_names);
 		}
+		free_sources(__static_ptr->sources, __static_ptr->file_count);
 		free (__static_ptr);
 	}
 
@@ -101,6 +142,8 @@ close_robocheck (void)
 	}
 
 	free_output_vector();
+	free_skipped_tools();
+	free_tool_runs();
 	close_library_handlers();
 }
 
@@ -145,6 +188,7 @@ extract_static_input (rbc_xml_doc doc_ptr)
 		}
 
 		__static_ptr->file_names = NULL;
+		__static_ptr->sources = NULL;
 
 		node = lookup_node(__root->children, vec, 3);
 		if (node == NULL)
@@ -173,6 +217,9 @@ extract_static_input (rbc_xml_doc doc_ptr)
 				__static_ptr->file_names[i] = get_node_property(node, "value");
 				node = get_next_node(node);
 			}
+
+			/* read once here, shared by every in-process module */
+			__static_ptr->sources = load_sources(__static_ptr->file_names, __static_ptr->file_count);
 		}
 	}
 
@@ -467,9 +514,23 @@ run_robocheck()
 		errset = extract_tool_errset(__root, tool_name);
 
 		tool_type = get_type(type);
+		if (tool_type == DYNAMIC_TOOL &&
+		    !check_tool_requirements(current_tool, tool_name))
+		{
+			current_tool_node = get_next_node(current_tool_node);
+			continue;
+		}
+
+		if (!check_tool_fallback(current_tool, tool_name, &errset))
+		{
+			current_tool_node = get_next_node(current_tool_node);
+			continue;
+		}
+
 		input = extract_tool_input(tool_name, tool_type);
 
 		output = load_module(input, errset, &err_count, lib_path, "run_tool");
+		add_tool_run(tool_name, output);
 		add_range(output);
 
 		current_tool_node = get_next_node(current_tool_node);
@@ -498,6 +559,194 @@ get_type(const char *type)
 	return tool_type;
 }
 
+/*
+ * Checks the capabilities a dynamic tool declares through its 'requires'
+ * property (e.g. requires="threads") against the tested executable.
+ * The executable is inspected only once, the first time it is needed.
+ */
+static int
+check_tool_requirements(rbc_xml_node tool, const char *tool_name)
+{
+	char buff[MAX_BUFF_SIZE] = {0}, *requires = NULL, *cap_name = NULL;
+	const char *requires_str = get_node_property(tool, "requires");
+	unsigned int cap;
+	int ret_value = 1;
+
+	if (requires_str == NULL || __dynamic_ptr == NULL)
+	{
+		return 1;
+	}
+
+	if (!__exec_inspected)
+	{
+		__exec_caps = inspect_executable(__dynamic_ptr->exec_name);
+		__exec_inspected = 1;
+	}
+
+	requires = strdup(requires_str);
+	if (requires == NULL)
+	{
+		log_message(NOMEM_ERR, NULL);
+		return 1;
+	}
+
+	for (cap_name = strtok(requires, ", "); cap_name != NULL; cap_name = strtok(NULL, ", "))
+	{
+		cap = get_capability(cap_name);
+		if (cap == RBC_CAP_NONE)
+		{
+			sprintf(buff, "Unknown capability '%s' required by tool '%s'.", cap_name, tool_name);
+			log_message(buff, NULL);
+			continue;
+		}
+
+		if ((__exec_caps & cap) == 0)
+		{
+			sprintf(buff, "executable does not use %s", cap_name);
+			add_skipped_tool(tool_name, buff);
+			ret_value = 0;
+			break;
+		}
+	}
+
+	free(requires);
+
+	return ret_value;
+}
+
+static void
+add_skipped_tool(const char *tool_name, const char *reason)
+{
+	char buff[MAX_BUFF_SIZE] = {0};
+	struct rbc_skipped_tool *temp = NULL;
+
+	temp = (struct rbc_skipped_tool *) realloc(__skipped, (__skipped_count + 1) * sizeof (struct rbc_skipped_tool));
+	if (temp == NULL)
+	{
+		log_message(NOMEM_ERR, stderr);
+		return;
+	}
+
+	__skipped = temp;
+	__skipped[__skipped_count].tool_name = strdup(tool_name);
+	__skipped[__skipped_count].reason = strdup(reason);
+	__skipped_count++;
+
+	sprintf(buff, "Skipping tool '%s': %s.", tool_name, reason);
+	log_message(buff, stderr);
+}
+
+static void
+free_skipped_tools(void)
+{
+	int i;
+
+	for (i = 0; i < __skipped_count; i++)
+	{
+		free(__skipped[i].tool_name);
+		free(__skipped[i].reason);
+	}
+
+	free(__skipped); __skipped = NULL;
+	__skipped_count = 0;
+}
+
+/*
+ * A tool declared with fallback_of="<tool>" is a slower second tier for
+ * the errors of the given tool, registered before it: it checks them only
+ * when that tool reported errors, and otherwise runs for the errors the
+ * first tier does not check, if it has any (errset is narrowed to them).
+ * Both reports are kept; the duplicates are dropped by add_range().
+ */
+static int
+check_tool_fallback(rbc_xml_node tool, const char *tool_name, rbc_errset_t *errset)
+{
+	char buff[MAX_BUFF_SIZE] = {0};
+	const char *primary = get_node_property(tool, "fallback_of");
+	rbc_errset_t covered;
+	unsigned int remaining = 0;
+	int i;
+
+	if (primary == NULL)
+	{
+		return 1;
+	}
+
+	for (i = 0; i < __run_count; i++)
+	{
+		if (strcmp(__runs[i].tool_name, primary) == 0)
+		{
+			break;
+		}
+	}
+
+	/* the first tier did not run: behave as a regular tool */
+	if (i == __run_count)
+	{
+		return 1;
+	}
+
+	if (__runs[i].err_count == 0)
+	{
+		covered = extract_tool_errset(__root, primary);
+		for (i = 0; i < (int) RBC_ERRSET_COUNT; i++)
+		{
+			errset->bit_set[i] &= ~covered.bit_set[i];
+			remaining |= errset->bit_set[i];
+		}
+
+		if (remaining == 0)
+		{
+			sprintf(buff, "%s reported no errors", primary);
+			add_skipped_tool(tool_name, buff);
+			return 0;
+		}
+
+		sprintf(buff, "Running tool '%s' for the errors %s does not check.",
+			tool_name, primary);
+		log_message(buff, stderr);
+		return 1;
+	}
+
+	sprintf(buff, "Running tool '%s': %s reported %d errors.",
+		tool_name, primary, __runs[i].err_count);
+	log_message(buff, stderr);
+
+	return 1;
+}
+
+static void
+add_tool_run(const char *tool_name, struct rbc_output *output)
+{
+	struct rbc_tool_run *temp = NULL;
+
+	temp = (struct rbc_tool_run *) realloc(__runs, (__run_count + 1) * sizeof (struct rbc_tool_run));
+	if (temp == NULL)
+	{
+		log_message(NOMEM_ERR, stderr);
+		return;
+	}
+
+	__runs = temp;
+	__runs[__run_count].tool_name = strdup(tool_name);
+	__runs[__run_count].err_count = (output != NULL) ? output->size : 0;
+	__run_count++;
+}
+
+static void
+free_tool_runs(void)
+{
+	int i;
+
+	for (i = 0; i < __run_count; i++)
+	{
+		free(__runs[i].tool_name);
+	}
+
+	free(__runs); __runs = NULL;
+	__run_count = 0;
+}
+
 struct rbc_input *
 extract_tool_input(const char *tool_name, enum EN_tool_type tool_type)
 {
@@ -912,7 +1161,26 @@ json_output_error_end(int code)
 static void
 json_output_end()
 {
-	fprintf(stdout, "\t]\n}\n");
+	int i;
+
+	fprintf(stdout, "\t]");
+
+	/* tools left out by the applicability check */
+	if (__skipped_count > 0)
+	{
+		fprintf(stdout, ",\n\t\"skipped\":\n\t[\n");
+		for (i = 0; i < __skipped_count; i++)
+		{
+			fprintf(stdout, "\t\t{ \"tool\" : \"%s\", \"reason\" : \"%s\" }",
+				__skipped[i].tool_name, __skipped[i].reason);
+			if (i != __skipped_count - 1)
+				fprintf(stdout, ",");
+			fprintf(stdout, "\n");
+		}
+		fprintf(stdout, "\t]");
+	}
+
+	fprintf(stdout, "\n}\n");
 	fflush(stdout);
 }
 
@@ -923,7 +1191,18 @@ update_errors()
 	struct rbc_out_info *aux = NULL;
 	static char penalty_buff[MAX_BUFF_SIZE];
 
-	if (__libpenalty == NULL || apply_penalty_ptr == NULL || __output == NULL) { return; }
+	if (__libpenalty == NULL || apply_penalty_ptr == NULL) { return; }
+
+	/* nothing to penalize: still show the tools that were skipped */
+	if (__output == NULL)
+	{
+		if (__skipped_count > 0)
+		{
+			json_output_start();
+			json_output_end();
+		}
+		return;
+	}
 
 #ifdef RBC_DEBUG
 	print_vector();
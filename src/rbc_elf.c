@@ -0,0 +1,416 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+	#include <elf.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "../lib/rbc_elf.h"
+#include "../lib/rbc_api.h"
+
+struct rbc_capability
+{
+	const char *name;
+	unsigned int mask;
+};
+
+static struct rbc_capability __capabilities[] =
+{
+	{"threads", RBC_CAP_THREADS},
+	{NULL, RBC_CAP_NONE}
+};
+
+unsigned int
+get_capability (const char *name)
+{
+	int i;
+
+	if (name == NULL)
+	{
+		return RBC_CAP_NONE;
+	}
+
+	for (i = 0; __capabilities[i].name != NULL; i++)
+	{
+		if (strcmp(__capabilities[i].name, name) == 0)
+		{
+			return __capabilities[i].mask;
+		}
+	}
+
+	return RBC_CAP_NONE;
+}
+
+const char *
+get_capability_name (unsigned int mask)
+{
+	int i;
+
+	for (i = 0; __capabilities[i].name != NULL; i++)
+	{
+		if (__capabilities[i].mask == mask)
+		{
+			return __capabilities[i].name;
+		}
+	}
+
+	return NULL_STRING;
+}
+
+#ifdef _WIN32
+
+/* PE images are not inspected; every tool is considered applicable. */
+unsigned int
+inspect_executable (const char *exec_name)
+{
+	return RBC_CAP_ALL;
+}
+
+#else
+
+/*
+ * Class independent view over the parts of an ELF image we need.
+ */
+struct elf_image
+{
+	const unsigned char *data;
+	size_t size;
+	int is64;
+};
+
+struct elf_section
+{
+	unsigned int type, link;
+	size_t offset, size, entsize;
+};
+
+static int
+in_image (struct elf_image *img, size_t offset, size_t len)
+{
+	return offset <= img->size && len <= img->size - offset;
+}
+
+static int
+read_section (struct elf_image *img, unsigned int index, struct elf_section *sec)
+{
+	size_t shoff, shentsize, shnum;
+
+	if (img->is64)
+	{
+		const Elf64_Ehdr *eh = (const Elf64_Ehdr *) img->data;
+		shoff = eh->e_shoff; shentsize = eh->e_shentsize; shnum = eh->e_shnum;
+	}
+	else
+	{
+		const Elf32_Ehdr *eh = (const Elf32_Ehdr *) img->data;
+		shoff = eh->e_shoff; shentsize = eh->e_shentsize; shnum = eh->e_shnum;
+	}
+
+	if (index >= shnum || !in_image(img, shoff + index * shentsize, shentsize))
+	{
+		return -1;
+	}
+
+	if (img->is64)
+	{
+		const Elf64_Shdr *sh = (const Elf64_Shdr *) (img->data + shoff + index * shentsize);
+		sec->type = sh->sh_type; sec->link = sh->sh_link;
+		sec->offset = sh->sh_offset; sec->size = sh->sh_size; sec->entsize = sh->sh_entsize;
+	}
+	else
+	{
+		const Elf32_Shdr *sh = (const Elf32_Shdr *) (img->data + shoff + index * shentsize);
+		sec->type = sh->sh_type; sec->link = sh->sh_link;
+		sec->offset = sh->sh_offset; sec->size = sh->sh_size; sec->entsize = sh->sh_entsize;
+	}
+
+	if (sec->type != SHT_NOBITS && !in_image(img, sec->offset, sec->size))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+static const char *
+read_string (struct elf_image *img, struct elf_section *strtab, size_t index)
+{
+	const char *str;
+
+	if (strtab->type != SHT_STRTAB || index >= strtab->size)
+	{
+		return NULL;
+	}
+
+	str = (const char *) img->data + strtab->offset + index;
+	if (memchr(str, '\0', strtab->size - index) == NULL)
+	{
+		return NULL;
+	}
+
+	return str;
+}
+
+static unsigned int
+library_capabilities (const char *name)
+{
+	if (strstr(name, "libpthread") != NULL || strstr(name, "libgomp") != NULL)
+	{
+		return RBC_CAP_THREADS;
+	}
+
+	return RBC_CAP_NONE;
+}
+
+static unsigned int
+symbol_capabilities (const char *name, int undefined)
+{
+	/* A dynamically linked program imports the thread API ... */
+	if (undefined && (strncmp(name, "pthread_", 8) == 0 ||
+			  strncmp(name, "thrd_", 5) == 0))
+	{
+		return RBC_CAP_THREADS;
+	}
+
+	/* ... while a static one carries the thread creation routines. */
+	if (!undefined && (strcmp(name, "pthread_create") == 0 ||
+			   strcmp(name, "thrd_create") == 0))
+	{
+		return RBC_CAP_THREADS;
+	}
+
+	return RBC_CAP_NONE;
+}
+
+static unsigned int
+scan_symbols (struct elf_image *img, struct elf_section *symtab, struct elf_section *strtab)
+{
+	unsigned int caps = RBC_CAP_NONE;
+	size_t i, count, entsize;
+
+	entsize = img->is64 ? sizeof (Elf64_Sym) : sizeof (Elf32_Sym);
+	if (symtab->entsize != 0 && symtab->entsize != entsize)
+	{
+		return RBC_CAP_NONE;
+	}
+
+	count = symtab->size / entsize;
+	for (i = 0; i < count; i++)
+	{
+		const char *name;
+		size_t name_index;
+		int undefined;
+
+		if (img->is64)
+		{
+			const Elf64_Sym *sym = (const Elf64_Sym *) (img->data + symtab->offset) + i;
+			name_index = sym->st_name;
+			undefined = (sym->st_shndx == SHN_UNDEF);
+		}
+		else
+		{
+			const Elf32_Sym *sym = (const Elf32_Sym *) (img->data + symtab->offset) + i;
+			name_index = sym->st_name;
+			undefined = (sym->st_shndx == SHN_UNDEF);
+		}
+
+		name = read_string(img, strtab, name_index);
+		if (name != NULL && *name != '\0')
+		{
+			caps |= symbol_capabilities(name, undefined);
+		}
+	}
+
+	return caps;
+}
+
+static unsigned int
+scan_dynamic (struct elf_image *img, struct elf_section *dynamic, struct elf_section *strtab)
+{
+	unsigned int caps = RBC_CAP_NONE;
+	size_t i, count, entsize;
+
+	entsize = img->is64 ? sizeof (Elf64_Dyn) : sizeof (Elf32_Dyn);
+	count = dynamic->size / entsize;
+
+	for (i = 0; i < count; i++)
+	{
+		long tag;
+		size_t value;
+		const char *name;
+
+		if (img->is64)
+		{
+			const Elf64_Dyn *dyn = (const Elf64_Dyn *) (img->data + dynamic->offset) + i;
+			tag = dyn->d_tag; value = dyn->d_un.d_val;
+		}
+		else
+		{
+			const Elf32_Dyn *dyn = (const Elf32_Dyn *) (img->data + dynamic->offset) + i;
+			tag = dyn->d_tag; value = dyn->d_un.d_val;
+		}
+
+		if (tag == DT_NULL)
+		{
+			break;
+		}
+
+		if (tag == DT_NEEDED)
+		{
+			name = read_string(img, strtab, value);
+			if (name != NULL)
+			{
+				caps |= library_capabilities(name);
+			}
+		}
+	}
+
+	return caps;
+}
+
+static int
+host_byte_order (void)
+{
+	const unsigned int probe = 1;
+
+	return (*(const unsigned char *) &probe == 1) ? ELFDATA2LSB : ELFDATA2MSB;
+}
+
+static unsigned int
+scan_image (struct elf_image *img)
+{
+	unsigned int caps = RBC_CAP_NONE, i, shnum;
+	struct elf_section sec, link;
+	int scanned = 0;
+
+	if (img->size < EI_NIDENT || memcmp(img->data, ELFMAG, SELFMAG) != 0)
+	{
+		return RBC_CAP_ALL;
+	}
+
+	switch (img->data[EI_CLASS])
+	{
+		case ELFCLASS32:
+			img->is64 = 0;
+			break;
+		case ELFCLASS64:
+			img->is64 = 1;
+			break;
+		default:
+			return RBC_CAP_ALL;
+	}
+
+	/* Only images in the host byte order are inspected. */
+	if (img->data[EI_DATA] != host_byte_order())
+	{
+		return RBC_CAP_ALL;
+	}
+
+	if (!in_image(img, 0, img->is64 ? sizeof (Elf64_Ehdr) : sizeof (Elf32_Ehdr)))
+	{
+		return RBC_CAP_ALL;
+	}
+
+	shnum = img->is64 ? ((const Elf64_Ehdr *) img->data)->e_shnum :
+			    ((const Elf32_Ehdr *) img->data)->e_shnum;
+	if (shnum == 0)
+	{
+		/* stripped section headers: nothing can be proven */
+		return RBC_CAP_ALL;
+	}
+
+	for (i = 0; i < shnum; i++)
+	{
+		if (read_section(img, i, &sec) != 0)
+		{
+			continue;
+		}
+
+		if (sec.type != SHT_DYNSYM && sec.type != SHT_SYMTAB && sec.type != SHT_DYNAMIC)
+		{
+			continue;
+		}
+
+		if (read_section(img, sec.link, &link) != 0)
+		{
+			continue;
+		}
+
+		if (sec.type == SHT_DYNAMIC)
+		{
+			caps |= scan_dynamic(img, &sec, &link);
+		}
+		else
+		{
+			caps |= scan_symbols(img, &sec, &link);
+		}
+		scanned = 1;
+	}
+
+	/* no symbol table and no dynamic section (e.g. a stripped static image) */
+	if (!scanned)
+	{
+		return RBC_CAP_ALL;
+	}
+
+	return caps;
+}
+
+/*
+ * inspect_executable
+ *
+ * Finds out which capabilities are used by the given executable by looking
+ * at its DT_NEEDED entries and symbol tables.
+ *
+ * returns: bit set of RBC_CAP_* values; RBC_CAP_ALL if the executable
+ * cannot be inspected, so that no tool is skipped by mistake.
+ * param1: exec_name = path of the tested executable
+ */
+unsigned int
+inspect_executable (const char *exec_name)
+{
+	unsigned int caps = RBC_CAP_ALL;
+	struct elf_image img;
+	struct stat st;
+	void *mapping;
+	int fd;
+
+	if (exec_name == NULL)
+	{
+		return caps;
+	}
+
+	fd = open(exec_name, O_RDONLY);
+	if (fd < 0)
+	{
+		return caps;
+	}
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED)
+		{
+			img.data = (const unsigned char *) mapping;
+			img.size = st.st_size;
+			img.is64 = 0;
+
+			caps = scan_image(&img);
+
+			munmap(mapping, st.st_size);
+		}
+	}
+
+	close(fd);
+
+	return caps;
+}
+
+#endif
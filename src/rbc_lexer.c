@@ -0,0 +1,281 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../lib/rbc_lexer.h"
+#include "../lib/rbc_constants.h"
+
+static const char *__keywords[] =
+{
+	"auto", "break", "case", "char", "const", "continue", "default", "do",
+	"double", "else", "enum", "extern", "float", "for", "goto", "if",
+	"inline", "int", "long", "register", "restrict", "return", "short",
+	"signed", "sizeof", "static", "struct", "switch", "typedef", "union",
+	"unsigned", "void", "volatile", "while", "_Bool", "_Complex",
+	NULL
+};
+
+/* longest first, so that the first match is the right one */
+static const char *__punctuators[] =
+{
+	"<<=", ">>=", "...", "->", "++", "--", "<<", ">>", "<=", ">=", "==",
+	"!=", "&&", "||", "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##",
+	NULL
+};
+
+static int
+add_token (struct rbc_token_list *, enum EN_token_type , const char *, int , int );
+
+static const char *
+skip_literal (const char *, const char *, int *);
+
+static const char *
+skip_directive (const char *, const char *, int *);
+
+static int
+is_keyword (const char *, int );
+
+static int
+add_token (struct rbc_token_list *list, enum EN_token_type type, const char *text,
+	   int len, int line)
+{
+	struct rbc_token *temp = NULL;
+
+	if (list->count == list->size)
+	{
+		list->size = list->size ? 2 * list->size : ALLOC_INC;
+		temp = (struct rbc_token *) realloc(list->tokens, list->size * sizeof (struct rbc_token));
+		if (temp == NULL)
+		{
+			return -1;
+		}
+		list->tokens = temp;
+	}
+
+	temp = &list->tokens[list->count++];
+	temp->type = type;
+	temp->text = text;
+	temp->len = len;
+	temp->line = line;
+
+	return 0;
+}
+
+/* Skips a string or character literal; p points at its opening quote. */
+static const char *
+skip_literal (const char *p, const char *end, int *line)
+{
+	char quote = *p;
+
+	for (p++; p < end && *p != quote && *p != '\n'; p++)
+	{
+		if (*p == '\\' && p + 1 < end)
+		{
+			if (*++p == '\n')
+			{
+				(*line)++;
+			}
+		}
+	}
+
+	return (p < end && *p == quote) ? p + 1 : p;
+}
+
+/* Skips a preprocessor line, with its continuations; p points at '#'. */
+static const char *
+skip_directive (const char *p, const char *end, int *line)
+{
+	for (; p < end && *p != '\n'; p++)
+	{
+		if (*p == '\\' && p + 1 < end && p[1] == '\n')
+		{
+			(*line)++;
+			p++;
+		}
+		else if (*p == '/' && p + 1 < end && p[1] == '*')
+		{
+			/* a comment may carry the directive over several lines */
+			for (p += 2; p + 1 < end && !(*p == '*' && p[1] == '/'); p++)
+			{
+				if (*p == '\n')
+				{
+					(*line)++;
+				}
+			}
+
+			if (p + 1 >= end)
+			{
+				return end;
+			}
+			p++;
+		}
+	}
+
+	return p < end ? p : end;
+}
+
+static int
+is_keyword (const char *text, int len)
+{
+	int i;
+
+	for (i = 0; __keywords[i] != NULL; i++)
+	{
+		if ((int) strlen(__keywords[i]) == len && strncmp(__keywords[i], text, len) == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * tokenize_source
+ *
+ * Splits a C source into tokens. Only what is needed to compare sources
+ * is recognized: preprocessor lines are kept whole, literals are not
+ * decoded and keywords are told apart from other identifiers.
+ *
+ * returns: the number of tokens /-1 - out of memory
+ * param1: start = the source
+ * param2: end = the end of the source
+ * param3: list = the list the tokens are appended to
+ */
+int
+tokenize_source (const char *start, const char *end, struct rbc_token_list *list)
+{
+	const char *p = start, *q = NULL;
+	int line = 1, line_start = 1, first = list->count, i, len, token_line, status = 0;
+	enum EN_token_type type;
+
+	while (p < end && status == 0)
+	{
+		if (*p == '\n')
+		{
+			line++;
+			line_start = 1;
+			p++;
+			continue;
+		}
+
+		if (isspace((unsigned char) *p))
+		{
+			p++;
+			continue;
+		}
+
+		if (*p == '\\' && p + 1 < end && p[1] == '\n')
+		{
+			p++;
+			continue;
+		}
+
+		if (*p == '/' && p + 1 < end && p[1] == '/')
+		{
+			while (p < end && *p != '\n')
+			{
+				p++;
+			}
+			continue;
+		}
+
+		if (*p == '/' && p + 1 < end && p[1] == '*')
+		{
+			for (p += 2; p + 1 < end && !(*p == '*' && p[1] == '/'); p++)
+			{
+				if (*p == '\n')
+				{
+					line++;
+				}
+			}
+			p = (p + 1 < end) ? p + 2 : end;
+			continue;
+		}
+
+		q = p;
+		token_line = line;
+
+		if (*p == '#' && line_start)
+		{
+			p = skip_directive(p, end, &line);
+			status = add_token(list, TOK_DIRECTIVE, q, p - q, token_line);
+		}
+		else if (*p == '"' || *p == '\'')
+		{
+			p = skip_literal(p, end, &line);
+			status = add_token(list, *q == '"' ? TOK_STRING : TOK_CHARACTER, q, p - q, token_line);
+		}
+		else if (isalpha((unsigned char) *p) || *p == '_')
+		{
+			while (p < end && (isalnum((unsigned char) *p) || *p == '_'))
+			{
+				p++;
+			}
+
+			/* L"", u8"", u'' and U'' prefixes belong to the literal */
+			if (p < end && (*p == '"' || *p == '\'') && p - q <= 2 &&
+			    strchr("LuU", *q) != NULL && (p - q == 1 || q[1] == '8'))
+			{
+				type = (*p == '"') ? TOK_STRING : TOK_CHARACTER;
+				p = skip_literal(p, end, &line);
+				status = add_token(list, type, q, p - q, token_line);
+			}
+			else
+			{
+				status = add_token(list, is_keyword(q, p - q) ? TOK_KEYWORD : TOK_IDENTIFIER,
+						   q, p - q, token_line);
+			}
+		}
+		else if (isdigit((unsigned char) *p) ||
+			 (*p == '.' && p + 1 < end && isdigit((unsigned char) p[1])))
+		{
+			/* preprocessing numbers, exponent signs included */
+			for (p++; p < end; p++)
+			{
+				if ((*p == '+' || *p == '-') && strchr("eEpP", p[-1]) != NULL)
+				{
+					continue;
+				}
+				if (!isalnum((unsigned char) *p) && *p != '.' && *p != '_')
+				{
+					break;
+				}
+			}
+			status = add_token(list, TOK_NUMBER, q, p - q, token_line);
+		}
+		else
+		{
+			for (i = 0; __punctuators[i] != NULL; i++)
+			{
+				len = strlen(__punctuators[i]);
+				if (p + len <= end && strncmp(p, __punctuators[i], len) == 0)
+				{
+					break;
+				}
+			}
+
+			p += (__punctuators[i] != NULL) ? len : 1;
+			status = add_token(list, TOK_PUNCTUATOR, q, p - q, token_line);
+		}
+
+		line_start = 0;
+	}
+
+	return (status == 0) ? list->count - first : -1;
+}
+
+void
+free_token_list (struct rbc_token_list *list)
+{
+	if (list == NULL)
+	{
+		return;
+	}
+
+	free(list->tokens);
+	list->tokens = NULL;
+	list->count = list->size = 0;
+}
@@ -0,0 +1,261 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "../lib/rbc_source.h"
+#include "../lib/rbc_api.h"
+#include "../lib/rbc_constants.h"
+
+static int
+map_source (const char *, struct rbc_source *);
+
+static int
+read_source (const char *, struct rbc_source *);
+
+static int
+index_lines (struct rbc_source *);
+
+#ifndef _WIN32
+static int
+map_source (const char *file_name, struct rbc_source *source)
+{
+	struct stat st;
+	void *mapping;
+	int fd;
+
+	fd = open(file_name, O_RDONLY);
+	if (fd == -1)
+	{
+		return -1;
+	}
+
+	if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+	{
+		close(fd);
+		return -1;
+	}
+
+	if (st.st_size == 0)
+	{
+		close(fd);
+		source->data = "";
+		source->size = 0;
+		return 0;
+	}
+
+	mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	source->data = (const char *) mapping;
+	source->size = st.st_size;
+	source->mapped = 1;
+
+	return 0;
+}
+#else
+static int
+map_source (const char *file_name, struct rbc_source *source)
+{
+	(void) file_name;
+	(void) source;
+
+	return -1;
+}
+#endif
+
+/* The fallback of map_source(), for systems without mmap. */
+static int
+read_source (const char *file_name, struct rbc_source *source)
+{
+	char *buff = NULL;
+	long size;
+	FILE *f;
+
+	f = fopen(file_name, "rb");
+	if (f == NULL)
+	{
+		return -1;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	buff = (size >= 0) ? (char *) malloc(size + 1) : NULL;
+	if (buff == NULL || (long) fread(buff, 1, size, f) != size)
+	{
+		free(buff);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	source->data = buff;
+	source->size = size;
+	source->mapped = 0;
+
+	return 0;
+}
+
+static int
+index_lines (struct rbc_source *source)
+{
+	const char *p = source->data, *end = source->data + source->size;
+	long *temp = NULL;
+	int size = ALLOC_INC;
+
+	source->line_offsets = (long *) malloc(size * sizeof (long));
+	if (source->line_offsets == NULL)
+	{
+		return -1;
+	}
+
+	source->line_offsets[0] = 0;
+	source->line_count = 1;
+
+	while ((p = (const char *) memchr(p, '\n', end - p)) != NULL && ++p < end)
+	{
+		if (source->line_count == size)
+		{
+			size *= 2;
+			temp = (long *) realloc(source->line_offsets, size * sizeof (long));
+			if (temp == NULL)
+			{
+				return -1;
+			}
+			source->line_offsets = temp;
+		}
+		source->line_offsets[source->line_count++] = p - source->data;
+	}
+
+	return 0;
+}
+
+/*
+ * load_sources
+ *
+ * Loads every source once, so that the in-process modules do not read
+ * and split them again. A source that cannot be read is left with a
+ * NULL data pointer and the others are loaded anyway.
+ *
+ * returns: an array of count sources /NULL - out of memory
+ * param1: file_names = the sources
+ * param2: count = the number of sources
+ */
+struct rbc_source *
+load_sources (const char **file_names, int count)
+{
+	struct rbc_source *sources = NULL;
+	char buff[MAX_BUFF_SIZE];
+	int i;
+
+	if (count <= 0)
+	{
+		return NULL;
+	}
+
+	sources = (struct rbc_source *) calloc(count, sizeof (struct rbc_source));
+	if (sources == NULL)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (file_names[i] == NULL)
+		{
+			continue;
+		}
+
+		if (map_source(file_names[i], &sources[i]) != 0 &&
+		    read_source(file_names[i], &sources[i]) != 0)
+		{
+			snprintf(buff, MAX_BUFF_SIZE, "Could not load source %s", file_names[i]);
+			log_message(buff, NULL);
+			continue;
+		}
+
+		if (index_lines(&sources[i]) != 0)
+		{
+			free_sources(sources, count);
+			return NULL;
+		}
+	}
+
+	return sources;
+}
+
+void
+free_sources (struct rbc_source *sources, int count)
+{
+	int i;
+
+	if (sources == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		free_token_list(&sources[i].tokens);
+		free(sources[i].line_offsets);
+
+		if (sources[i].data == NULL || sources[i].size == 0)
+		{
+			continue;
+		}
+#ifndef _WIN32
+		if (sources[i].mapped)
+		{
+			munmap((void *) sources[i].data, sources[i].size);
+			continue;
+		}
+#endif
+		free((void *) sources[i].data);
+	}
+
+	free(sources);
+}
+
+/*
+ * get_source_tokens
+ *
+ * Splits a source into tokens the first time they are needed; the
+ * following calls return the same list.
+ *
+ * returns: the tokens of the source /NULL - not loaded or out of memory
+ * param1: source = the source
+ */
+const struct rbc_token_list *
+get_source_tokens (struct rbc_source *source)
+{
+	if (source == NULL || source->data == NULL)
+	{
+		return NULL;
+	}
+
+	if (source->tokenized == 0)
+	{
+		source->tokenized = 1;
+		if (tokenize_source(source->data, source->data + source->size, &source->tokens) < 0)
+		{
+			free_token_list(&source->tokens);
+			source->tokenized = -1;
+		}
+	}
+
+	return (source->tokenized == 1) ? &source->tokens : NULL;
+}
@@ -0,0 +1,532 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#ifndef _WIN32
+	#include <glob.h>
+	#include <unistd.h>
+#endif
+
+#include "../lib/rbc_trace.h"
+
+#ifdef _WIN32
+
+/* Interposition libraries are only built for ELF platforms. */
+int
+run_preloaded (struct rbc_input *input, const char *default_preload, const char *log_base)
+{
+	return -1;
+}
+
+int
+parse_trace_logs (const char *log_base, const struct rbc_trace_kind *kinds,
+		  struct rbc_dynamic_input *dynamic_input, rbc_errset_t flags,
+		  struct rbc_output **output)
+{
+	return 0;
+}
+
+#else
+
+#define TRACE_LINE_MAX		8192
+#define ADDR2LINE_CMD		"addr2line -f -e"
+#define ADDR2LINE_BATCH		64
+/* the command line of run_preloaded(), besides the library path */
+#define PRELOAD_CMD_MAX		4096
+#define PRELOAD_PARAM		"-preload="
+
+struct trace_frame
+{
+	char *object;
+	unsigned long offset;
+
+	char *function;
+	char *file;
+	int line;
+};
+
+struct trace_record
+{
+	enum EN_err_type err_type;
+	int first, count;
+};
+
+struct trace_data
+{
+	struct trace_frame *frames;
+	int frame_count, frame_size;
+
+	struct trace_record *records;
+	int record_count, record_size;
+};
+
+static int
+get_preload_path (struct rbc_input *, const char *, char *);
+
+static enum EN_err_type
+lookup_kind (const struct rbc_trace_kind *, rbc_errset_t , const char *);
+
+static int
+read_trace_log (const char *, const struct rbc_trace_kind *, rbc_errset_t , struct trace_data *);
+
+static void
+resolve_object (struct trace_data *, const char *);
+
+static void
+resolve_frames (struct trace_data *);
+
+static int
+report_records (struct trace_data *, struct rbc_dynamic_input *, struct rbc_output **);
+
+static void
+free_trace_data (struct trace_data *);
+
+/*
+ * The interposition library given through the -preload= parameter, or
+ * the default one, as an absolute path: the tested program may change
+ * its working directory.
+ */
+static int
+get_preload_path (struct rbc_input *input, const char *default_preload, char *path)
+{
+	const char *preload = default_preload;
+	int i;
+
+	for (i = 0; i < input->args_count; i++)
+	{
+		if (input->tool_args[i] != NULL
+			&& strncmp(input->tool_args[i], PRELOAD_PARAM, strlen(PRELOAD_PARAM)) == 0)
+		{
+			preload = input->tool_args[i] + strlen(PRELOAD_PARAM);
+		}
+	}
+
+	return realpath(preload, path) != NULL;
+}
+
+static enum EN_err_type
+lookup_kind (const struct rbc_trace_kind *kinds, rbc_errset_t flags, const char *kind)
+{
+	int i;
+
+	for (i = 0; kinds[i].kind != NULL; i++)
+	{
+		if (strcmp(kinds[i].kind, kind) == 0)
+		{
+			return ISSET_ERR(kinds[i].err_type, flags) ? kinds[i].err_type : ERR_NONE;
+		}
+	}
+
+	return ERR_NONE;
+}
+
+static int
+add_frame (struct trace_data *data, const char *frame)
+{
+	const char *plus = strrchr(frame, '+');
+	struct trace_frame *temp = NULL;
+
+	if (plus == NULL || plus == frame)
+	{
+		return -1;
+	}
+
+	if (data->frame_count == data->frame_size)
+	{
+		data->frame_size = data->frame_size ? 2 * data->frame_size : ALLOC_INC;
+		temp = (struct trace_frame *) realloc(data->frames, data->frame_size * sizeof (struct trace_frame));
+		if (temp == NULL)
+		{
+			return -1;
+		}
+		data->frames = temp;
+	}
+
+	temp = &data->frames[data->frame_count];
+	temp->object = (char *) malloc(plus - frame + 1);
+	if (temp->object == NULL)
+	{
+		return -1;
+	}
+
+	memcpy(temp->object, frame, plus - frame);
+	temp->object[plus - frame] = '\0';
+	temp->offset = strtoul(plus + 1, NULL, 16);
+	temp->function = temp->file = NULL;
+	temp->line = 0;
+	data->frame_count++;
+
+	return 0;
+}
+
+static int
+read_trace_log (const char *log_name, const struct rbc_trace_kind *kinds,
+		rbc_errset_t flags, struct trace_data *data)
+{
+	char line[TRACE_LINE_MAX], *kind = NULL, *frame = NULL, *save = NULL;
+	enum EN_err_type err_type;
+	struct trace_record *temp = NULL;
+	FILE *log = NULL;
+
+	log = fopen(log_name, "rt");
+	if (log == NULL)
+	{
+		return -1;
+	}
+
+	while (fgets(line, TRACE_LINE_MAX, log) != NULL)
+	{
+		kind = strtok_r(line, " \r\n", &save);
+		if (kind == NULL)
+		{
+			continue;
+		}
+
+		err_type = lookup_kind(kinds, flags, kind);
+		if (err_type == ERR_NONE || strtok_r(NULL, " \r\n", &save) == NULL)
+		{
+			continue;
+		}
+
+		if (data->record_count == data->record_size)
+		{
+			data->record_size = data->record_size ? 2 * data->record_size : ALLOC_INC;
+			temp = (struct trace_record *) realloc(data->records, data->record_size * sizeof (struct trace_record));
+			if (temp == NULL)
+			{
+				break;
+			}
+			data->records = temp;
+		}
+
+		temp = &data->records[data->record_count++];
+		temp->err_type = err_type;
+		temp->first = data->frame_count;
+
+		while ((frame = strtok_r(NULL, " \r\n", &save)) != NULL)
+		{
+			add_frame(data, frame);
+		}
+
+		temp->count = data->frame_count - temp->first;
+	}
+
+	fclose(log);
+
+	return 0;
+}
+
+/*
+ * System libraries carry no sources of the tested program, so their
+ * frames are not worth a lookup.
+ */
+static int
+is_system_object (const char *object)
+{
+	return strncmp(object, "/lib", 4) == 0 || strncmp(object, "/usr/lib", 8) == 0 ||
+	       strchr(object, '\'') != NULL;
+}
+
+static void
+set_location (struct trace_frame *frame, char *function, char *location)
+{
+	char *p = NULL, *file = NULL;
+
+	function[strcspn(function, "\r\n")] = '\0';
+	location[strcspn(location, " \r\n")] = '\0';
+
+	p = strrchr(location, ':');
+	if (p == NULL || strcmp(function, "??") == 0 || strncmp(location, "??", 2) == 0)
+	{
+		return;
+	}
+
+	*p = '\0';
+	file = strrchr(location, '/');
+	file = (file != NULL) ? file + 1 : location;
+
+	frame->line = atoi(p + 1);
+	frame->function = strdup(function);
+	frame->file = strdup(file);
+}
+
+/*
+ * Looks up, through addr2line, every frame of the given object. Addresses
+ * are passed in batches, so an object costs a few processes no matter how
+ * many frames point into it.
+ */
+static void
+resolve_object (struct trace_data *data, const char *object)
+{
+	char command[TRACE_LINE_MAX], function[TRACE_LINE_MAX], location[TRACE_LINE_MAX];
+	int batch[ADDR2LINE_BATCH];
+	int i, j, count, len;
+	FILE *pipe = NULL;
+
+	for (i = 0; i < data->frame_count; )
+	{
+		len = snprintf(command, sizeof (command), "%s '%s'", ADDR2LINE_CMD, object);
+		for (count = 0; i < data->frame_count && count < ADDR2LINE_BATCH; i++)
+		{
+			if (strcmp(data->frames[i].object, object) == 0 && data->frames[i].function == NULL)
+			{
+				len += snprintf(command + len, sizeof (command) - len, " 0x%lx", data->frames[i].offset);
+				batch[count++] = i;
+			}
+		}
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		len += snprintf(command + len, sizeof (command) - len, " 2> /dev/null");
+
+		pipe = popen(command, "r");
+		if (pipe == NULL)
+		{
+			log_message("Failed running addr2line.", NULL);
+			return;
+		}
+
+		for (j = 0; j < count; j++)
+		{
+			if (fgets(function, sizeof (function), pipe) == NULL ||
+			    fgets(location, sizeof (location), pipe) == NULL)
+			{
+				break;
+			}
+
+			set_location(&data->frames[batch[j]], function, location);
+		}
+
+		pclose(pipe);
+	}
+}
+
+static void
+resolve_frames (struct trace_data *data)
+{
+	int i, j, seen;
+
+	for (i = 0; i < data->frame_count; i++)
+	{
+		if (is_system_object(data->frames[i].object))
+		{
+			continue;
+		}
+
+		/* each object is resolved when its first frame is met */
+		for (seen = 0, j = 0; j < i && !seen; j++)
+		{
+			seen = (strcmp(data->frames[j].object, data->frames[i].object) == 0);
+		}
+
+		if (!seen)
+		{
+			resolve_object(data, data->frames[i].object);
+		}
+	}
+}
+
+static int
+is_source (struct rbc_dynamic_input *dynamic_input, const char *file)
+{
+	int i;
+	const char *s = NULL;
+
+	for (i = 0; dynamic_input->sources != NULL && i < dynamic_input->source_count; i++)
+	{
+		s = strrchr(dynamic_input->sources[i], '/');
+		s = (s != NULL) ? s + 1 : dynamic_input->sources[i];
+
+		if (strcmp(file, s) == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * add() replaces a duplicate and drops the nodes that follow it, so
+ * records repeated by loops are filtered out before reaching it.
+ */
+static int
+is_reported (struct rbc_output *output, enum EN_err_type err_type, const char *msg)
+{
+	for (; output != NULL; output = output->next)
+	{
+		if (output->err_type == err_type && output->err_msg != NULL &&
+		    strcmp(output->err_msg, msg) == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Every record is reported at its innermost frame that belongs to one of
+ * the sources, with the same message rbc_valgrind.c builds.
+ */
+static int
+report_records (struct trace_data *data, struct rbc_dynamic_input *dynamic_input,
+		struct rbc_output **output)
+{
+	char buff[MAX_BUFF_SIZE];
+	int i, j, reported = 0;
+	struct trace_frame *frame = NULL;
+	struct rbc_output node;
+
+	for (i = 0; i < data->record_count; i++)
+	{
+		for (j = 0; j < data->records[i].count; j++)
+		{
+			frame = &data->frames[data->records[i].first + j];
+			if (frame->file == NULL || !is_source(dynamic_input, frame->file))
+			{
+				continue;
+			}
+
+			snprintf(buff, sizeof (buff), "In function %s, in file %s, at line %d",
+				 frame->function, frame->file, frame->line);
+			if (is_reported(*output, data->records[i].err_type, buff))
+			{
+				break;
+			}
+
+			node.err_type = data->records[i].err_type;
+			node.err_msg = strdup(buff);
+			node.aux_info = NULL;
+			add(output, node);
+			reported++;
+			break;
+		}
+	}
+
+	return reported;
+}
+
+static void
+free_trace_data (struct trace_data *data)
+{
+	int i;
+
+	for (i = 0; i < data->frame_count; i++)
+	{
+		free(data->frames[i].object);
+		free(data->frames[i].function);
+		free(data->frames[i].file);
+	}
+
+	free(data->frames);
+	free(data->records);
+}
+
+/*
+ * run_preloaded
+ *
+ * Runs the tested executable, with its parameters, with an interposition
+ * library preloaded; the library writes its trace logs to <log_base>.<pid>.
+ *
+ * returns: 0 - the executable was run /-1 - the library was not found /
+ *	    -2 - the command line is too long
+ * param1: input = the tool input (parameters, executable)
+ * param2: default_preload = the library used without a -preload= parameter
+ * param3: log_base = the value given to the library through RBC_TRACE_LOG
+ */
+int
+run_preloaded (struct rbc_input *input, const char *default_preload, const char *log_base)
+{
+	char command[PATH_MAX + PRELOAD_CMD_MAX], preload[PATH_MAX];
+	struct rbc_dynamic_input *dynamic_input = (struct rbc_dynamic_input *) input->input_ptr;
+	int i, len;
+
+	if (!get_preload_path(input, default_preload, preload))
+	{
+		return -1;
+	}
+
+	len = snprintf(command, sizeof (command), "LD_PRELOAD='%s' RBC_TRACE_LOG=%s %s",
+		       preload, log_base, dynamic_input->exec_name);
+	for (i = 0; i < dynamic_input->params_count && len < (int) sizeof (command); i++)
+	{
+		len += snprintf(command + len, sizeof (command) - len, " %s", dynamic_input->params[i]);
+	}
+	if (len < (int) sizeof (command))
+	{
+		len += snprintf(command + len, sizeof (command) - len, " > /dev/null");
+	}
+
+	/* a cut command would run something else */
+	if (len >= (int) sizeof (command))
+	{
+		log_message("Command line of the preloaded executable is too long.", stderr);
+		return -2;
+	}
+
+	system(command);
+
+	return 0;
+}
+
+/*
+ * parse_trace_logs
+ *
+ * Parses the trace logs written by an interposition library (one per
+ * process, named <log_base>.<pid>), resolves their frames to source lines
+ * and removes the logs.
+ *
+ * returns: the number of records reported
+ * param1: log_base = the value given to the library through RBC_TRACE_LOG
+ * param2: kinds = the record kinds the module understands
+ * param3: dynamic_input = the sources of the tested program
+ * param4: flags = the tracked errors
+ * param5: output = the list of errors the records are added to
+ */
+int
+parse_trace_logs (const char *log_base, const struct rbc_trace_kind *kinds,
+		  struct rbc_dynamic_input *dynamic_input, rbc_errset_t flags,
+		  struct rbc_output **output)
+{
+	char pattern[MAX_BUFF_SIZE];
+	struct trace_data data;
+	glob_t logs;
+	size_t i;
+	int reported = 0;
+
+	if (log_base == NULL || kinds == NULL || dynamic_input == NULL || output == NULL)
+	{
+		return 0;
+	}
+
+	memset(&data, 0, sizeof (data));
+	snprintf(pattern, sizeof (pattern), "%s.*", log_base);
+
+	if (glob(pattern, 0, NULL, &logs) != 0)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < logs.gl_pathc; i++)
+	{
+		read_trace_log(logs.gl_pathv[i], kinds, flags, &data);
+		unlink(logs.gl_pathv[i]);
+	}
+
+	globfree(&logs);
+
+	resolve_frames(&data);
+	reported = report_records(&data, dynamic_input, output);
+	free_trace_data(&data);
+
+	return reported;
+}
+
+#endif
@@ -1,4 +1,5 @@
 #define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>